@@ -4,95 +4,154 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 
-// read instructions from the input stream
-void ReadInput(std::vector<int>& output, std::istream& input)
-{
-	std::string entry;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int value;
-		sstream >> value;
-		output.push_back(value);
-	}
-}
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Batch.h"
+#include "../Intcode/ThreadPool.h"
+#include "../Intcode/Symbolic.h"
 
-// run
-bool Run(std::vector<int>& program)
+// run the program on a noun and verb, returning false if it does not halt
+bool Run(const std::vector<int>& program, int noun, int verb, int& result)
 {
-	for (int i = 0; i < program.size(); i += 4)
-	{
-		int op = program[i];
-		int in1 = program[i + 1];
-		int in2 = program[i + 2];
-		int out = program[i + 3];
+	// make a copy of the data
+	Computer<int, std::vector<int>> computer(program);
 
-		switch (op)
-		{
-		case 1: // add
-			program[out] = program[in1] + program[in2];
-			break;
-
-		case 2: // multiply
-			program[out] = program[in1] * program[in2];
-			break;
-		
-		case 99: // end
-			return true;
-
-		default:
-			// ERROR
-			return false;
-		}
-	}
+	computer.memory[1] = noun;
+	computer.memory[2] = verb;
+
+	if (computer.Run() != State::Halt)
+		return false;
+	result = computer.memory[0];
 	return true;
 }
 
 // PART 1
 void Part1(const std::vector<int>& program)
 {
-	// make a copy of the data
-	std::vector<int> memory = program;
-
-	memory[1] = 12;
-	memory[2] = 2;
-
-	Run(memory);
+	int result = 0;
+	Run(program, 12, 2, result);
 
-	std::cout << "Part 1: result " << memory[0] << std::endl;
+	std::cout << "Part 1: result " << result << std::endl;
 }
 
 // PART 2
-void Part2(const std::vector<int>& program)
+struct Search
 {
-	for (int noun = 0; noun < 100; ++noun)
+	int target = 19690720;
+	int size = 100;		// nouns and verbs run from 0 to size - 1
+};
+
+// solve for the noun and verb from a closed form of the result, which works
+// when the program computes an affine function of them
+// (the answer is checked with a real run, since the closed form only holds
+// for the nouns and verbs the symbolic run could follow)
+bool Solve(const std::vector<int>& program, const Search& search, int& noun, int& verb)
+{
+	std::vector<Symbol> memory;
+	if (RunSymbolic(program, { 1, 2 }, memory) != State::Halt || !memory[0].known || memory[0].value.Degree() > 1)
+		return false;
+
+	// result = c + a * noun + b * verb
+	const Polynomial& result = memory[0].value;
+	const int64_t c = result.Coefficient();
+	const int64_t a = result.Coefficient(0);
+	const int64_t b = result.Coefficient(1);
+	for (noun = 0; noun < search.size; ++noun)
 	{
-		for (int verb = 0; verb < 100; ++verb)
+		const int64_t rest = search.target - c - a * noun;
+		if (b == 0 ? rest == 0 : rest % b == 0 && rest / b >= 0 && rest / b < search.size)
+		{
+			verb = b == 0 ? 0 : int(rest / b);
+			int check;
+			return Run(program, noun, verb, check) && check == search.target;
+		}
+	}
+	return false;
+}
+
+// run every noun and verb across a thread pool
+// (each chunk is a block of verbs for a noun, run side by side in the
+// worker's batch, until one of them finds the target)
+bool Sweep(const std::vector<int>& program, const Search& search, int& noun, int& verb)
+{
+	static ThreadPool pool;
+
+	constexpr int BlockSize = 128;
+	const int blocks = (search.size + BlockSize - 1) / BlockSize;
+	const uint64_t work = uint64_t(search.size) * blocks;
+
+	// a batch for each worker, reused for every block it runs
+	std::vector<Batch<int>> batches(pool.Workers(), Batch<int>(std::min(BlockSize, search.size)));
+
+	std::atomic<bool> found(false);
+	std::atomic<int64_t> result(-1);
+	pool.ParallelFor(0, work, 1, [&](size_t worker, uint64_t item)
 		{
-			// make a copy of the program
-			std::vector<int> memory = program;
-			memory[1] = noun;
-			memory[2] = verb;
+			if (found.load(std::memory_order_relaxed))
+				return;
+
+			const int n = int(item / blocks);
+			const int first = int(item % blocks) * BlockSize;
+			const int count = std::min(BlockSize, search.size - first);
 
-			Run(memory);
+			Batch<int>& batch = batches[worker];
+			batch.Load(program);
+			for (int lane = 0; lane < count; ++lane)
+			{
+				batch.At(lane, 1) = n;
+				batch.At(lane, 2) = first + lane;
+			}
+			batch.Run();
 
-			if (memory[0] == 19690720)
+			for (int lane = 0; lane < count; ++lane)
 			{
-				std::cout << "Part 2: noun=" << noun << " verb=" << verb << " result=" << noun * 100 + verb << std::endl;
-				break;
+				if (batch.LaneState(lane) == State::Halt && batch.At(lane, 0) == search.target)
+				{
+					int64_t none = -1;
+					result.compare_exchange_strong(none, int64_t(n) * search.size + first + lane);
+					found = true;
+					break;
+				}
 			}
 		}
+	);
+
+	if (!found)
+		return false;
+	noun = int(result / search.size);
+	verb = int(result % search.size);
+	return true;
+}
+
+void Part2(const std::vector<int>& program, Search search)
+{
+	// nouns and verbs are addresses, so they have to be inside the program
+	search.size = std::min(search.size, int(program.size()));
+
+	int noun, verb;
+	if (Solve(program, search, noun, verb) || Sweep(program, search, noun, verb))
+	{
+		std::cout << "Part 2: noun=" << noun << " verb=" << verb << " result=" << noun * 100 + verb << std::endl;
 	}
 }
 
-int main()
+// usage: 02 [target [size]] < input.txt
+int main(int argc, char* argv[])
 {
+	Search search;
+	if (argc > 1)
+		search.target = atoi(argv[1]);
+	if (argc > 2)
+		search.size = atoi(argv[2]);
+
 	std::vector<int> program;
 	ReadInput(program, std::cin);
 
 	Part1(program);
-	Part2(program);
+	Part2(program, search);
 
 	return 0;
 }
@@ -5,243 +5,170 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <map>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
 
-constexpr int N = 5;
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Batch.h"
+#include "../Intcode/Pipe.h"
+#include "../Intcode/ThreadPool.h"
 
-enum class Opcode
-{
-	Add = 1,
-	Multiply = 2,
-	Input = 3,
-	Output = 4,
-	JumpIfTrue = 5,
-	JumpIfFalse = 6,
-	LessThan = 7,
-	Equals = 8,
-	Halt = 99
-};
-
-enum class Mode
-{
-	Position = 0,
-	Immediate = 1
-};
+// run each amplifier on its own thread in part 2
+#define THREADED_PIPELINE 0
 
-enum class State
-{
-	Run,
-	Halt,
-	Error
-};
+// time part 2 with and without threads
+#define COMPARE_PIPELINES 0
 
-// read instructions from the input stream
-void ReadInput(std::vector<int>& output, std::istream& input)
-{
-	std::string entry;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int value;
-		sstream >> value;
-		output.push_back(value);
-	}
-}
+// spread the part 2 permutations over a thread pool
+#define PARALLEL_SEARCH 1
 
-// run one instruction
-State RunInstruction(std::vector<int>& program, std::vector<int>& input, std::vector<int>& output, int& pc)
-{
-	int instruction = program[pc++];
-
-	// decode the instruction
-	const Opcode opcode = Opcode(instruction % 100); instruction /= 100;
-	const Mode mode1 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode2 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode3 = Mode(instruction % 10); instruction /= 10;
-
-	switch (opcode)
-	{
-	case Opcode::Add:
-	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		int out = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		program[out] = in1 + in2;
-		return State::Run;
-	}
+constexpr int N = 5;
 
-	case Opcode::Multiply:
+template<typename F>
+void HeapPermutations(int a[], int size, int n, const F& op)
+{
+	if (size == 1)
 	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		int out = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		program[out] = in1 * in2;
-		return State::Run;
+		op(a);
+		return;
 	}
 
-	case Opcode::Input:
+	for (int i = 0; i < size; ++i)
 	{
-		if (input.empty())
+		HeapPermutations(a, size - 1, n, op);
+		if (size & 1)
 		{
-			// wait for innput
-			--pc;
+			std::swap(a[0], a[size - 1]);
 		}
 		else
 		{
-			// get input
-			int out = program[pc++];
-			program[out] = input.front();
-			input.erase(input.begin());
+			std::swap(a[i], a[size - 1]);
 		}
-		return State::Run;
-	}
-
-	case Opcode::Output:
-	{
-		int in = program[pc++];
-		if (mode1 == Mode::Position)
-			in = program[in];
-		output.push_back(in);
-		return State::Run;
-	}
-
-	case Opcode::JumpIfTrue:
-	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		if (in1 != 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::JumpIfFalse:
-	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		if (in1 == 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::LessThan:
-	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		int out = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		program[out] = in1 < in2;
-		return State::Run;
 	}
+}
 
-	case Opcode::Equals:
-	{
-		int in1 = program[pc++];
-		int in2 = program[pc++];
-		int out = program[pc++];
-		if (mode1 == Mode::Position)
-			in1 = program[in1];
-		if (mode2 == Mode::Position)
-			in2 = program[in2];
-		program[out] = in1 == in2;
-		return State::Run;
-	}
+uint64_t Factorial(int n)
+{
+	uint64_t result = 1;
+	for (int i = 2; i <= n; ++i)
+		result *= i;
+	return result;
+}
 
-	case Opcode::Halt:
+// the permutation of sorted values with a given rank in lexicographic order,
+// reading the rank as a number in the factorial base
+// (built in place: each digit rotates its value to the front of those left,
+// which stay sorted)
+void Unrank(uint64_t rank, const int sorted[], int n, int permutation[])
+{
+	std::copy(sorted, sorted + n, permutation);
+	for (int i = 0; i < n; ++i)
 	{
-		// HALT
-		--pc;
-		return State::Halt;
+		const uint64_t place = Factorial(n - 1 - i);
+		const int digit = int(rank / place);
+		rank %= place;
+		std::rotate(permutation + i, permutation + i + digit, permutation + i + digit + 1);
 	}
+}
 
-	default:
+// rank of a permutation of distinct values in lexicographic order
+uint64_t Rank(const int permutation[], int n)
+{
+	uint64_t rank = 0;
+	for (int i = 0; i < n; ++i)
 	{
-		// ERROR
-		--pc;
-		return State::Error;
-	}
+		int smaller = 0;
+		for (int j = i + 1; j < n; ++j)
+		{
+			if (permutation[j] < permutation[i])
+				++smaller;
+		}
+		rank += smaller * Factorial(n - 1 - i);
 	}
+	return rank;
 }
 
-// run
-State Run(std::vector<int>& program, std::vector<int>& input, std::vector<int>& output)
+// PART 1
+// amplifier output by phase setting and input signal
+// (every amplifier runs the same program, so which amplifier it is does not matter)
+using AmplifierCache = std::map<std::pair<int, int>, int>;
+
+// run an amplifier for each phase setting and input signal, side by side
+void Amplify(const std::vector<int>& program, const std::vector<std::pair<int, int>>& keys, AmplifierCache& cache)
 {
-	std::vector<int>::iterator input_itor = input.begin();
+	if (keys.empty())
+		return;
 
-	int pc = 0;
-	State state = State::Run;
-	do
+	Batch<int> batch(keys.size());
+	batch.Load(program);
+	for (size_t k = 0; k < keys.size(); ++k)
 	{
-		state = RunInstruction(program, input, output, pc);
+		batch.Feed(k, keys[k].first);
+		batch.Feed(k, keys[k].second);
 	}
-	while (state == State::Run && pc < program.size());
-
-	return state;
+	batch.Run();
+	for (size_t k = 0; k < keys.size(); ++k)
+		cache[keys[k]] = batch.Output(k).back();
 }
 
-template<typename F>
-void HeapPermutations(int a[], int size, int n, const F& op)
+void Part1(const std::vector<int>& program)
 {
-	if (size == 1)
+	int highest = INT_MIN;
+
+	// grow the permutations one amplifier at a time, so permutations that
+	// share a prefix share its signal, and only run the amplifier for phase
+	// and signal pairs that have not been seen before
+	struct Prefix
 	{
-		op(a);
-		return;
-	}
+		std::vector<int> phase;
+		int signal;
+	};
+	std::vector<Prefix> prefixes(1, Prefix{ {}, 0 });
+	AmplifierCache cache;
 
-	for (int i = 0; i < size; ++i)
+	for (int i = 0; i < N; ++i)
 	{
-		HeapPermutations(a, size - 1, n, op);
-		if (size & 1)
+		std::vector<std::pair<int, int>> keys;
+		for (const Prefix& prefix : prefixes)
 		{
-			std::swap(a[0], a[size - 1]);
+			for (int p = 0; p < N; ++p)
+			{
+				if (std::find(prefix.phase.begin(), prefix.phase.end(), p) == prefix.phase.end() && !cache.count({ p, prefix.signal }))
+					keys.push_back({ p, prefix.signal });
+			}
 		}
-		else
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		Amplify(program, keys, cache);
+
+		std::vector<Prefix> longer;
+		for (const Prefix& prefix : prefixes)
 		{
-			std::swap(a[i], a[size - 1]);
+			for (int p = 0; p < N; ++p)
+			{
+				if (std::find(prefix.phase.begin(), prefix.phase.end(), p) != prefix.phase.end())
+					continue;
+				longer.push_back(prefix);
+				longer.back().phase.push_back(p);
+				longer.back().signal = cache[{ p, prefix.signal }];
+			}
 		}
+		prefixes.swap(longer);
 	}
-}
 
-// PART 1
-void Part1(const std::vector<int>& program)
-{
-	int highest = INT_MIN;
+	// the signals by permutation rank, listed in the usual order
+	std::vector<int> results(prefixes.size());
+	for (const Prefix& prefix : prefixes)
+		results[size_t(Rank(prefix.phase.data(), N))] = prefix.signal;
 
 	int phase[N] = { 0, 1, 2, 3, 4 };
 	HeapPermutations(phase, N, N, [&](int a[])
 		{
-			std::vector<int> input, output;
-			output.push_back(0);
-
-			for (int i = 0; i < N; ++i)
-			{
-				// make a copy of the program for each amplifier
-				std::vector<int> memory = program;
-				input.clear();
-				input.push_back(phase[i]);
-				input.push_back(output.back());
-				output.clear();
-				Run(memory, input, output);
-			}
-
-			int result = output.back();
+			const int result = results[size_t(Rank(a, N))];
 			std::cout << result << std::endl;
 
 			if (highest < result)
@@ -255,45 +182,170 @@ void Part1(const std::vector<int>& program)
 }
 
 // PART 2
-void Part2(const std::vector<int>& program)
+using Amplifier = Computer<int, std::vector<int>>;
+
+// run the feedback loop on one thread, switching to the next amplifier only
+// when one blocks on input, and return the last output of the last amplifier
+int FeedbackCooperative(const std::vector<int>& program, const int phase[], std::vector<Amplifier>& amplifier)
 {
-	int highest = INT_MIN;
+	const size_t stages = amplifier.size();
+
+	// reset each amplifier with its phase setting
+	for (size_t i = 0; i < stages; ++i)
+	{
+		amplifier[i].Load(program);
+		amplifier[i].Feed(phase[i]);
+	}
 
-	// make a copy of the program for each amplifier
-	std::array<std::vector<int>, N> memory;
-	memory.fill(program);
+	// initial input for amplifier A
+	amplifier[0].Feed(0);
 
-	int phase[N] = { 5, 6, 7, 8, 9 };
-	HeapPermutations(phase, N, N, [&](int a[])
+	// run each amplifier until it needs input, until the last amplifier halts
+	int result = 0;
+	State last;
+	do
+	{
+		for (size_t i = 0; i < stages; ++i)
+		{
+			last = amplifier[i].RunUntil();
+
+			// pass output to the next amplifier
+			Channel<int>& output = amplifier[i].output;
+			if (i == stages - 1 && !output.empty())
+				result = output.back();
+			output.Drain(amplifier[(i + 1) % stages].input);
+		}
+	}
+	while (last == State::Wait);
+
+	return result;
+}
+
+// run the feedback loop with a thread for each amplifier, linked by pipes
+int FeedbackThreaded(const std::vector<int>& program, const int phase[], std::vector<Amplifier>& amplifier)
+{
+	const size_t stages = amplifier.size();
+
+	// pipe i feeds amplifier i
+	std::vector<std::unique_ptr<Pipe<int>>> pipes(stages);
+	for (size_t i = 0; i < stages; ++i)
+	{
+		pipes[i].reset(new Pipe<int>(64));
+		pipes[i]->Push(phase[i]);
+	}
+	pipes[0]->Push(0);
+
+	int result = 0;
+	auto run = [&](size_t i)
+	{
+		Amplifier& computer = amplifier[i];
+		computer.Load(program);
+		Pipe<int>& in = *pipes[i];
+		Pipe<int>& out = *pipes[(i + 1) % stages];
+
+		for (;;)
 		{
-			// data for each stage
-			std::vector<int> data[N];
+			const State state = computer.RunUntil();
+			while (!computer.output.empty())
+			{
+				const int value = computer.output.Pop();
+				if (i == stages - 1)
+					result = value;
+				out.Push(value);
+			}
+
+			int value;
+			if (state != State::Wait || !in.Pop(value))
+				break;
+			computer.Feed(value);
+		}
+
+		// let the next amplifier finish if it is waiting on this one
+		out.Close();
+	};
 
-			// phase settings for each stage
-			for (int i = 0; i < N; ++i)
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < stages; ++i)
+		threads.emplace_back(run, i);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	return result;
+}
+
+// run the feedback loop for every permutation of the phases across a thread
+// pool, storing each result by the permutation's rank and returning the highest
+int SearchParallel(const std::vector<int>& program, std::vector<int> phases, std::vector<int>& results)
+{
+	static ThreadPool pool;
+
+	std::sort(phases.begin(), phases.end());
+	const int stages = int(phases.size());
+	const uint64_t count = Factorial(stages);
+	results.assign(size_t(count), 0);
+
+	// amplifiers and a phase buffer for each worker, reused for every
+	// permutation it runs
+	std::vector<std::vector<Amplifier>> amplifiers(pool.Workers(), std::vector<Amplifier>(stages));
+	std::vector<std::vector<int>> phase(pool.Workers(), std::vector<int>(stages));
+
+	std::atomic<int> highest(INT_MIN);
+	pool.ParallelFor(0, count, std::max<uint64_t>(1, count / (pool.Workers() * 16)), [&](size_t worker, uint64_t rank)
+		{
+			Unrank(rank, phases.data(), stages, phase[worker].data());
+			const int result = FeedbackCooperative(program, phase[worker].data(), amplifiers[worker]);
+			results[size_t(rank)] = result;
+
+			// raise the highest without a lock
+			int current = highest.load(std::memory_order_relaxed);
+			while (result > current && !highest.compare_exchange_weak(current, result, std::memory_order_relaxed))
 			{
-				data[i].push_back(phase[i]);
 			}
+		}
+	);
+	return highest;
+}
 
-			// initial input for amplifier A
-			data[0].push_back(0);
+void Part2(const std::vector<int>& program)
+{
+	int highest = INT_MIN;
 
-			// state for each amplifier
-			int pc[N] = { 0, 0, 0, 0, 0 };
-			State state[N] = { State::Run, State::Run, State::Run, State::Run, State::Run };
+	// one computer for each amplifier
+	std::vector<Amplifier> amplifier(N);
 
-			// run until the last amplifier halts
-			do
+#if COMPARE_PIPELINES
+	// time every permutation with both schedulers
+	for (int threaded = 0; threaded < 2; ++threaded)
+	{
+		int phase[N] = { 5, 6, 7, 8, 9 };
+		int64_t total = 0;
+		const auto start = std::chrono::steady_clock::now();
+		HeapPermutations(phase, N, N, [&](int a[])
 			{
-				for (int i = 0; i < N; ++i)
-				{
-					state[i] = RunInstruction(memory[i], data[i], data[(i + 1) % N], pc[i]);
-				}
+				total += threaded ? FeedbackThreaded(program, a, amplifier) : FeedbackCooperative(program, a, amplifier);
 			}
-			while (state[N - 1] == State::Run);
+		);
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << (threaded ? "threaded: " : "cooperative: ") << elapsed.count() << " ms (" << total << ")" << std::endl;
+	}
+#endif
 
-			// get the output from the last amplifier
-			int result = data[0].back();
+	int phase[N] = { 5, 6, 7, 8, 9 };
+#if PARALLEL_SEARCH
+	std::vector<int> results;
+	highest = SearchParallel(program, std::vector<int>(phase, phase + N), results);
+#endif
+	HeapPermutations(phase, N, N, [&](int a[])
+		{
+#if PARALLEL_SEARCH
+			const int result = results[size_t(Rank(a, N))];
+#elif THREADED_PIPELINE
+			const int result = FeedbackThreaded(program, a, amplifier);
+#else
+			const int result = FeedbackCooperative(program, a, amplifier);
+#endif
+
+			// the output from the last amplifier
 			std::cout << result << std::endl;
 
 			if (highest < result)
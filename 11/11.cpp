@@ -4,37 +4,11 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <unordered_map>
 #include <algorithm>
 
-enum class Opcode
-{
-	Add = 1,
-	Multiply = 2,
-	Input = 3,
-	Output = 4,
-	JumpIfTrue = 5,
-	JumpIfFalse = 6,
-	LessThan = 7,
-	Equals = 8,
-	RelativeBaseOffset = 9,
-	Halt = 99
-};
-
-enum class Mode
-{
-	Position = 0,
-	Immediate = 1,
-	Relative = 2,
-};
-
-enum class State
-{
-	Run,
-	Halt,
-	Error
-};
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Coroutine.h"
 
 enum class Color : int8_t
 {
@@ -80,259 +54,99 @@ namespace std
 	};
 }
 
-// read instructions from the input stream
-void ReadInput(std::map<int64_t, int64_t>& output, std::istream& input)
+// turn, then move forward one tile
+void Move(Point& position, Direction& direction, Turn turn)
 {
-	std::string entry;
-	int64_t pc = 0;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int64_t value;
-		sstream >> value;
-		output[pc++] = value;
+	// turn
+	switch (turn)
+	{
+	case Turn::Left:
+		direction = Direction((int(direction) + int(Direction::Count) - 1) % int(Direction::Count));
+		break;
+	case Turn::Right:
+		direction = Direction((int(direction) + 1) % int(Direction::Count));
+		break;
+	}
+
+	// move
+	switch (direction)
+	{
+	case Direction::Up:
+		position.y -= 1;
+		break;
+	case Direction::Right:
+		position.x += 1;
+		break;
+	case Direction::Down:
+		position.y += 1;
+		break;
+	case Direction::Left:
+		position.x -= 1;
+		break;
 	}
 }
 
-// run one instruction
-State RunInstruction(std::map<int64_t, int64_t>& program, std::vector<int64_t>& input, std::vector<int64_t>& output, int64_t& pc, int64_t& relativebase)
+#if INTCODE_COROUTINES
+// the robot, taking paint and turn instructions from its brain
+Task Robot(Machine<int64_t>& brain, std::unordered_map<Point, Color>& hull, Point position, Direction direction)
 {
-	int64_t instruction = program[pc++];
-
-	// decode the instruction
-	const Opcode opcode = Opcode(instruction % 100); instruction /= 100;
-	const Mode mode1 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode2 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode3 = Mode(instruction % 10); instruction /= 10;
-
-	switch (opcode)
-	{
-	case Opcode::Add:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 + in2;
-		return State::Run;
-	}
-
-	case Opcode::Multiply:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 * in2;
-		return State::Run;
-	}
-
-	case Opcode::Input:
-	{
-		if (input.empty())
-		{
-			// wait for innput
-			--pc;
-		}
-		else
-		{
-			// get input
-			int64_t out = program[pc++];
-			if (mode1 == Mode::Relative)
-				out += relativebase;
-			program[out] = input.front();
-			input.erase(input.begin());
-		}
-		return State::Run;
-	}
-
-	case Opcode::Output:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		output.push_back(in);
-		return State::Run;
-	}
-
-	case Opcode::JumpIfTrue:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 != 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::JumpIfFalse:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 == 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::LessThan:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 < in2;
-		return State::Run;
-	}
-
-	case Opcode::Equals:
+	for (;;)
 	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 == in2;
-		return State::Run;
-	}
+		// camera sees the current tile
+		co_await brain.Write(int64_t(hull[position]));
 
-	case Opcode::RelativeBaseOffset:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		relativebase += in;
-		return State::Run;
-	}
+		const std::optional<int64_t> color = co_await brain.Read();
+		const std::optional<int64_t> turn = co_await brain.Read();
+		if (!color || !turn)
+			break;
 
-	case Opcode::Halt:
-	{
-		// HALT
-		--pc;
-		return State::Halt;
-	}
+		// paint the current tile
+		hull[position] = Color(*color);
 
-	default:
-	{
-		// ERROR
-		--pc;
-		return State::Error;
-	}
+		Move(position, direction, Turn(*turn));
 	}
 }
 
-void Run(const std::map<int64_t, int64_t>& program, std::unordered_map<Point, Color>& hull, Point position, Direction direction)
+void Run(const PagedMemory<int64_t>& program, std::unordered_map<Point, Color>& hull, Point position, Direction direction)
 {
-	std::map<int64_t, int64_t> memory = program;
-
-	std::vector<int64_t> input, output;
+	Computer<int64_t> computer(program);
+	Scheduler scheduler;
+	Machine<int64_t> brain(computer, scheduler);
+	scheduler.Spawn(Robot(brain, hull, position, direction));
+	scheduler.Run();
+}
+#else
+void Run(const PagedMemory<int64_t>& program, std::unordered_map<Point, Color>& hull, Point position, Direction direction)
+{
+	Computer<int64_t> computer(program);
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
 	State state = State::Run;
 	do
 	{
-		input.clear();
-		input.push_back(int(hull[position]));
+		// camera sees the current tile
+		computer.input.clear();
+		computer.Feed(int(hull[position]));
 
-		state = RunInstruction(memory, input, output, pc, relativebase);
+		state = computer.RunUntil(2);
 
-		if (state == State::Run && output.size() == 2)
+		if (state == State::Output)
 		{
-			Color color = Color(output[0]);
-			Turn turn = Turn(output[1]);
-			output.clear();
+			Color color = Color(computer.output[0]);
+			Turn turn = Turn(computer.output[1]);
+			computer.output.clear();
 
 			// paint the current tile
 			hull[position] = color;
 
-			// turn
-			switch (turn)
-			{
-			case Turn::Left:
-				direction = Direction((int(direction) + int(Direction::Count) - 1) % int(Direction::Count));
-				break;
-			case Turn::Right:
-				direction = Direction((int(direction) + 1) % int(Direction::Count));
-				break;
-			}
-
-			// move
-			switch (direction)
-			{
-			case Direction::Up:
-				position.y -= 1;
-				break;
-			case Direction::Right:
-				position.x += 1;
-				break;
-			case Direction::Down:
-				position.y += 1;
-				break;
-			case Direction::Left:
-				position.x -= 1;
-				break;
-			}
+			Move(position, direction, turn);
 		}
 	}
-	while (state == State::Run);
+	while (state == State::Output);
 }
+#endif
 
 // PART 1
-void Part1(const std::map<int64_t, int64_t>& program)
+void Part1(const PagedMemory<int64_t>& program)
 {
 	std::unordered_map<Point, Color> hull;
 
@@ -342,7 +156,7 @@ void Part1(const std::map<int64_t, int64_t>& program)
 }
 
 // PART 2
-void Part2(const std::map<int64_t, int64_t>& program)
+void Part2(const PagedMemory<int64_t>& program)
 {
 	std::unordered_map<Point, Color> hull;
 
@@ -379,7 +193,7 @@ void Part2(const std::map<int64_t, int64_t>& program)
 
 int main()
 {
-	std::map<int64_t, int64_t> program;
+	PagedMemory<int64_t> program;
 	ReadInput(program, std::cin);
 
 	Part1(program);
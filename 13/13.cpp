@@ -5,41 +5,22 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <unordered_map>
 #include <algorithm>
 
+#include "../Intcode/Intcode.h"
+
 #include <Windows.h>
 
 #define INTERACTIVE_MODE 0
 
-enum class Opcode
-{
-	Add = 1,
-	Multiply = 2,
-	Input = 3,
-	Output = 4,
-	JumpIfTrue = 5,
-	JumpIfFalse = 6,
-	LessThan = 7,
-	Equals = 8,
-	RelativeBaseOffset = 9,
-	Halt = 99
-};
-
-enum class Mode
-{
-	Position = 0,
-	Immediate = 1,
-	Relative = 2,
-};
+// save the joystick moves of part 2 to 13.log, or replay them from it
+#define RECORD_INPUT 0
+#define REPLAY_INPUT 0
 
-enum class State
-{
-	Run,
-	Halt,
-	Error
-};
+// save part 2 to 13.ckp as it runs, or carry on from the last save
+#define SAVE_CHECKPOINTS 0
+#define RESUME_CHECKPOINT 0
 
 enum class Tile : int8_t
 {
@@ -82,223 +63,20 @@ namespace std
 	};
 }
 
-// read instructions from the input stream
-void ReadInput(std::map<int64_t, int64_t>& output, std::istream& input)
-{
-	std::string entry;
-	int64_t pc = 0;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int64_t value;
-		sstream >> value;
-		output[pc++] = value;
-	}
-}
-
-// run one instruction
-State RunInstruction(std::map<int64_t, int64_t>& program, std::vector<int64_t>& input, std::vector<int64_t>& output, int64_t& pc, int64_t& relativebase)
-{
-	int64_t instruction = program[pc++];
-
-	// decode the instruction
-	const Opcode opcode = Opcode(instruction % 100); instruction /= 100;
-	const Mode mode1 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode2 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode3 = Mode(instruction % 10); instruction /= 10;
-
-	switch (opcode)
-	{
-	case Opcode::Add:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 + in2;
-		return State::Run;
-	}
-
-	case Opcode::Multiply:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 * in2;
-		return State::Run;
-	}
-
-	case Opcode::Input:
-	{
-		if (input.empty())
-		{
-			// wait for innput
-			--pc;
-		}
-		else
-		{
-			// get input
-			int64_t out = program[pc++];
-			if (mode1 == Mode::Relative)
-				out += relativebase;
-			program[out] = input.front();
-			input.erase(input.begin());
-		}
-		return State::Run;
-	}
-
-	case Opcode::Output:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		output.push_back(in);
-		return State::Run;
-	}
-
-	case Opcode::JumpIfTrue:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 != 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::JumpIfFalse:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 == 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::LessThan:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 < in2;
-		return State::Run;
-	}
-
-	case Opcode::Equals:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 == in2;
-		return State::Run;
-	}
-
-	case Opcode::RelativeBaseOffset:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		relativebase += in;
-		return State::Run;
-	}
-
-	case Opcode::Halt:
-	{
-		// HALT
-		--pc;
-		return State::Halt;
-	}
-
-	default:
-	{
-		// ERROR
-		--pc;
-		return State::Error;
-	}
-	}
-}
-
 // PART 1
-void Part1(const std::map<int64_t, int64_t>& program)
+void Part1(const PagedMemory<int64_t>& program)
 {
-	std::map<int64_t, int64_t> memory = program;
+	Computer<int64_t> computer(program);
 
 	std::unordered_map<Point, Tile> screen;
 
-	std::vector<int64_t> input, output;
+	Channel<int64_t>& output = computer.output;
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
-	State state = State::Run;
-	do
+	while (computer.RunUntil(3) == State::Output)
 	{
-		state = RunInstruction(memory, input, output, pc, relativebase);
-
-		if (state == State::Run && output.size() == 3)
-		{
-			screen[{short(output[0]), short(output[1])}] = Tile(output[2]);
-			output.clear();
-		}
+		screen[{short(output[0]), short(output[1])}] = Tile(output[2]);
+		output.clear();
 	}
-	while (state == State::Run);
 
 	int blocks = 0;
 	for (const auto &pixel : screen)
@@ -310,10 +88,21 @@ void Part1(const std::map<int64_t, int64_t>& program)
 }
 
 // PART 2
-void Part2(const std::map<int64_t, int64_t>& program)
+void Part2(const PagedMemory<int64_t>& program)
 {
-	std::map<int64_t, int64_t> memory = program;
-	memory[0] = 2;
+	Computer<int64_t> computer(program);
+	computer.memory[0] = 2;
+
+#if RECORD_INPUT
+	InputLog log;
+	log.Poke(0, 2);
+	computer.recording = &log;
+#endif
+#if SAVE_CHECKPOINTS
+	// every thousand frames or so
+	Checkpointer checkpoints("13.ckp", 1000);
+	computer.checkpoints = &checkpoints;
+#endif
 
 	// set up the handles for reading/writing:
 	HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -323,66 +112,82 @@ void Part2(const std::map<int64_t, int64_t>& program)
 	CONSOLE_CURSOR_INFO cursorInfo = { 100, FALSE };
 	SetConsoleCursorInfo(hOut, &cursorInfo);
 
-	std::vector<int64_t> input, output;
+	Channel<int64_t>& input = computer.input;
+	Channel<int64_t>& output = computer.output;
+#if INTERACTIVE_MODE != 0
 	input.push_back(0);
+#endif
 
 	int64_t score = 0;
 
 	int64_t ball_x = 0;
 	int64_t paddle_x = 0;
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
+#if RESUME_CHECKPOINT
+	// the game and where the ball and paddle were
+	Checkpoint checkpoint;
+	if (checkpoint.Load("13.ckp") && checkpoint.host.size() == 3 && computer.Restore(checkpoint))
+	{
+		score = checkpoint.host[0];
+		ball_x = checkpoint.host[1];
+		paddle_x = checkpoint.host[2];
+	}
+#endif
+
 	State state = State::Run;
 	do
 	{
+#if SAVE_CHECKPOINTS
+		checkpoints.host = { score, ball_x, paddle_x };
+#endif
+		state = computer.RunUntil(3);
+
+		if (state == State::Wait)
+		{
 #if INTERACTIVE_MODE == 0
-		// automatic mode
-		input.clear();
-		input.push_back(ball_x - paddle_x);
+			// automatic mode
+			input.push_back(ball_x - paddle_x);
 #else
-		// interactive mode
-		DWORD numEvents = 0;
-		if (GetNumberOfConsoleInputEvents(hIn, &numEvents) && numEvents > 0)
-		{
-			INPUT_RECORD eventBuffer[16];
-			ReadConsoleInput(hIn, eventBuffer, 16, &numEvents);
-			for (DWORD i = 0; i < numEvents; ++i)
+			// interactive mode
+			DWORD numEvents = 0;
+			if (GetNumberOfConsoleInputEvents(hIn, &numEvents) && numEvents > 0)
 			{
-				switch (eventBuffer[i].EventType)
+				INPUT_RECORD eventBuffer[16];
+				ReadConsoleInput(hIn, eventBuffer, 16, &numEvents);
+				for (DWORD i = 0; i < numEvents; ++i)
 				{
-				case KEY_EVENT:
-					if (eventBuffer[i].Event.KeyEvent.bKeyDown)
+					switch (eventBuffer[i].EventType)
 					{
-						switch (eventBuffer[i].Event.KeyEvent.wVirtualKeyCode)
+					case KEY_EVENT:
+						if (eventBuffer[i].Event.KeyEvent.bKeyDown)
 						{
-						case 'A':
-						case VK_LEFT:
-							input.clear();
-							input.push_back(-1);
-							break;
-
-						case 'D':
-						case VK_RIGHT:
-							input.clear();
-							input.push_back(+1);
-							break;
-
-						case 'S':
-						case VK_UP:
-							input.clear();
-							input.push_back(0);
-							break;
+							switch (eventBuffer[i].Event.KeyEvent.wVirtualKeyCode)
+							{
+							case 'A':
+							case VK_LEFT:
+								input.clear();
+								input.push_back(-1);
+								break;
+
+							case 'D':
+							case VK_RIGHT:
+								input.clear();
+								input.push_back(+1);
+								break;
+
+							case 'S':
+							case VK_UP:
+								input.clear();
+								input.push_back(0);
+								break;
+							}
 						}
 					}
 				}
 			}
-		}
 #endif
-
-		state = RunInstruction(memory, input, output, pc, relativebase);
-
-		if (state == State::Run && output.size() == 3)
+		}
+		else if (state == State::Output)
 		{
 			if (output[0] == -1 && output[1] == 0)
 			{
@@ -404,20 +209,53 @@ void Part2(const std::map<int64_t, int64_t>& program)
 			output.clear();
 		}
 	}
-	while (state == State::Run);
+	while (state == State::Wait || state == State::Output);
 
 	std::cout << "Part 2: score=" << score << std::endl;
+
+#if RECORD_INPUT
+	log.Save("13.log");
+#endif
 }
 
+#if REPLAY_INPUT
+// rerun part 2 on the joystick moves of a recorded run, with no paddle logic
+void Replay(const PagedMemory<int64_t>& program)
+{
+	InputLog log;
+	if (!log.Load("13.log"))
+	{
+		std::cerr << "no 13.log to replay" << std::endl;
+		return;
+	}
+
+	Computer<int64_t> computer(program);
+	log.Replay(computer);
+
+	const std::vector<int64_t> values = computer.Drain();
+	int64_t score = 0;
+	for (size_t n = 0; n + 2 < values.size(); n += 3)
+	{
+		if (values[n] == -1 && values[n + 1] == 0)
+			score = values[n + 2];
+	}
+	std::cout << "Replay: score=" << score << ", " << log.Inputs().size() << " inputs, " << log.Instructions() << " instructions";
+	std::cout << (log.Matches(values) ? "" : ", outputs differ from the recording") << std::endl;
+}
+#endif
+
 int main()
 {
 	std::ifstream inputFile;
 	inputFile.open("input.txt", std::ios::in);
-	std::map<int64_t, int64_t> program;
+	PagedMemory<int64_t> program;
 	ReadInput(program, inputFile);
 
 	Part1(program);
 	Part2(program);
+#if REPLAY_INPUT
+	Replay(program);
+#endif
 
 	return 0;
 }
@@ -5,47 +5,24 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
 
+#include "../Intcode/Intcode.h"
+
 #define VISUALIZE 0
 
+// save the robot's moves while exploring to 15.log, or replay them from it
+#define RECORD_INPUT 0
+#define REPLAY_INPUT 0
+
 #if VISUALIZE
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <Windows.h>
 #endif
 
-enum class Opcode
-{
-	Add = 1,
-	Multiply = 2,
-	Input = 3,
-	Output = 4,
-	JumpIfTrue = 5,
-	JumpIfFalse = 6,
-	LessThan = 7,
-	Equals = 8,
-	RelativeBaseOffset = 9,
-	Halt = 99
-};
-
-enum class Mode
-{
-	Position = 0,
-	Immediate = 1,
-	Relative = 2,
-};
-
-enum class State
-{
-	Run,
-	Halt,
-	Error
-};
-
 enum class Movement
 {
 	None = 0,
@@ -112,206 +89,18 @@ namespace std
 	};
 }
 
-// read instructions from the input stream
-void ReadInput(std::map<int64_t, int64_t>& output, std::istream& input)
-{
-	std::string entry;
-	int64_t pc = 0;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int64_t value;
-		sstream >> value;
-		output[pc++] = value;
-	}
-}
-
-// run one instruction
-State RunInstruction(std::map<int64_t, int64_t>& program, std::vector<int64_t>& input, std::vector<int64_t>& output, int64_t& pc, int64_t& relativebase)
+Point Explore(const PagedMemory<int64_t>& program, std::unordered_map<Point, Status>& environment, std::unordered_map<Point, Movement>& entered)
 {
-	int64_t instruction = program[pc++];
-
-	// decode the instruction
-	const Opcode opcode = Opcode(instruction % 100); instruction /= 100;
-	const Mode mode1 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode2 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode3 = Mode(instruction % 10); instruction /= 10;
-
-	switch (opcode)
-	{
-	case Opcode::Add:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 + in2;
-		return State::Run;
-	}
-
-	case Opcode::Multiply:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 * in2;
-		return State::Run;
-	}
-
-	case Opcode::Input:
-	{
-		if (input.empty())
-		{
-			// wait for innput
-			--pc;
-		}
-		else
-		{
-			// get input
-			int64_t out = program[pc++];
-			if (mode1 == Mode::Relative)
-				out += relativebase;
-			program[out] = input.front();
-			input.erase(input.begin());
-		}
-		return State::Run;
-	}
-
-	case Opcode::Output:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		output.push_back(in);
-		return State::Run;
-	}
-
-	case Opcode::JumpIfTrue:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 != 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::JumpIfFalse:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 == 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::LessThan:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 < in2;
-		return State::Run;
-	}
-
-	case Opcode::Equals:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 == in2;
-		return State::Run;
-	}
-
-	case Opcode::RelativeBaseOffset:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		relativebase += in;
-		return State::Run;
-	}
-
-	case Opcode::Halt:
-	{
-		// HALT
-		--pc;
-		return State::Halt;
-	}
-
-	default:
-	{
-		// ERROR
-		--pc;
-		return State::Error;
-	}
-	}
-}
-
-Point Explore(const std::map<int64_t, int64_t>& program, std::unordered_map<Point, Status>& environment, std::unordered_map<Point, Movement>& entered)
-{
-	std::map<int64_t, int64_t> memory = program;
+	Computer<int64_t> computer(program);
 	std::vector<Movement> stack;
 
-	std::vector<int64_t> input, output;
+#if RECORD_INPUT
+	InputLog log;
+	computer.recording = &log;
+#endif
+
+	Channel<int64_t>& input = computer.input;
+	Channel<int64_t>& output = computer.output;
 
 #if VISUALIZE
 	// set up the handles for reading/writing:
@@ -344,19 +133,14 @@ Point Explore(const std::map<int64_t, int64_t>& program, std::unordered_map<Poin
 	}
 #endif
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
+	input.push_back(int64_t(movement));
+
 	State state = State::Run;
 	do
 	{
-		if (input.empty())
-		{
-			input.push_back(int64_t(movement));
-		}
-
-		state = RunInstruction(memory, input, output, pc, relativebase);
+		state = computer.RunUntil(1);
 
-		if (state == State::Run && !output.empty())
+		if (state == State::Output)
 		{
 			Status status = Status(output[0]);
 
@@ -451,13 +235,36 @@ Point Explore(const std::map<int64_t, int64_t>& program, std::unordered_map<Poin
 			input.push_back(int64_t(movement));
 		}
 	}
-	while (state == State::Run);
+	while (state == State::Output);
+
+#if RECORD_INPUT
+	log.Save("15.log");
+#endif
 
 	return goal;
 }
 
+#if REPLAY_INPUT
+// rerun the exploration on the moves of a recorded run, with no search logic
+void Replay(const PagedMemory<int64_t>& program)
+{
+	InputLog log;
+	if (!log.Load("15.log"))
+	{
+		std::cerr << "no 15.log to replay" << std::endl;
+		return;
+	}
+
+	Computer<int64_t> computer(program);
+	log.Replay(computer);
+
+	std::cout << "Replay: " << log.Inputs().size() << " moves, " << log.Instructions() << " instructions";
+	std::cout << (log.Matches(computer.Drain()) ? "" : ", outputs differ from the recording") << std::endl;
+}
+#endif
+
 // PART 1
-void Part1(const std::map<int64_t, int64_t>& program, const std::unordered_map<Point, Status>& environment, const std::unordered_map<Point, Movement>& entered, Point goal)
+void Part1(const PagedMemory<int64_t>& program, const std::unordered_map<Point, Status>& environment, const std::unordered_map<Point, Movement>& entered, Point goal)
 {
 	// trace back from the goal
 	Point position = goal;
@@ -477,7 +284,7 @@ void Part1(const std::map<int64_t, int64_t>& program, const std::unordered_map<P
 }
 
 // PART 2
-void Part2(const std::map<int64_t, int64_t>& program, const std::unordered_map<Point, Status>& environment, const std::unordered_map<Point, Movement>& entered, Point goal)
+void Part2(const PagedMemory<int64_t>& program, const std::unordered_map<Point, Status>& environment, const std::unordered_map<Point, Movement>& entered, Point goal)
 {
 	std::unordered_map<Point, int> goal_dist;
 	goal_dist[goal] = 0;
@@ -539,7 +346,7 @@ int main()
 {
 	std::ifstream inputFile;
 	inputFile.open("input.txt", std::ios::in);
-	std::map<int64_t, int64_t> program;
+	PagedMemory<int64_t> program;
 	ReadInput(program, inputFile);
 
 	std::unordered_map<Point, Status> environment;
@@ -548,6 +355,9 @@ int main()
 
 	Part1(program, environment, entered, goal);
 	Part2(program, environment, entered, goal);
+#if REPLAY_INPUT
+	Replay(program);
+#endif
 
 	return 0;
 }
@@ -5,38 +5,11 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
 
-enum class Opcode
-{
-	Add = 1,
-	Multiply = 2,
-	Input = 3,
-	Output = 4,
-	JumpIfTrue = 5,
-	JumpIfFalse = 6,
-	LessThan = 7,
-	Equals = 8,
-	RelativeBaseOffset = 9,
-	Halt = 99
-};
-
-enum class Mode
-{
-	Position = 0,
-	Immediate = 1,
-	Relative = 2,
-};
-
-enum class State
-{
-	Run,
-	Halt,
-	Error
-};
+#include "../Intcode/Intcode.h"
 
 enum class Direction
 {
@@ -82,213 +55,12 @@ namespace std
 	};
 }
 
-// read instructions from the input stream
-void ReadInput(std::map<int64_t, int64_t>& output, std::istream& input)
-{
-	std::string entry;
-	int64_t pc = 0;
-	while (std::getline(input, entry, ','))
-	{
-		std::stringstream sstream(entry);
-		int64_t value;
-		sstream >> value;
-		output[pc++] = value;
-	}
-}
-
-// run one instruction
-State RunInstruction(std::map<int64_t, int64_t>& program, std::vector<int64_t>& input, std::vector<int64_t>& output, int64_t& pc, int64_t& relativebase)
-{
-	int64_t instruction = program[pc++];
-
-	// decode the instruction
-	const Opcode opcode = Opcode(instruction % 100); instruction /= 100;
-	const Mode mode1 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode2 = Mode(instruction % 10); instruction /= 10;
-	const Mode mode3 = Mode(instruction % 10); instruction /= 10;
-
-	switch (opcode)
-	{
-	case Opcode::Add:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 + in2;
-		return State::Run;
-	}
-
-	case Opcode::Multiply:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 * in2;
-		return State::Run;
-	}
-
-	case Opcode::Input:
-	{
-		if (input.empty())
-		{
-			// wait for innput
-			--pc;
-		}
-		else
-		{
-			// get input
-			int64_t out = program[pc++];
-			if (mode1 == Mode::Relative)
-				out += relativebase;
-			program[out] = input.front();
-			input.erase(input.begin());
-		}
-		return State::Run;
-	}
-
-	case Opcode::Output:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		output.push_back(in);
-		return State::Run;
-	}
-
-	case Opcode::JumpIfTrue:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 != 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::JumpIfFalse:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (in1 == 0)
-			pc = in2;
-		return State::Run;
-	}
-
-	case Opcode::LessThan:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 < in2;
-		return State::Run;
-	}
-
-	case Opcode::Equals:
-	{
-		int64_t in1 = program[pc++];
-		int64_t in2 = program[pc++];
-		int64_t out = program[pc++];
-		if (mode1 == Mode::Relative)
-			in1 += relativebase;
-		if (mode1 != Mode::Immediate)
-			in1 = program[in1];
-		if (mode2 == Mode::Relative)
-			in2 += relativebase;
-		if (mode2 != Mode::Immediate)
-			in2 = program[in2];
-		if (mode3 == Mode::Relative)
-			out += relativebase;
-		program[out] = in1 == in2;
-		return State::Run;
-	}
-
-	case Opcode::RelativeBaseOffset:
-	{
-		int64_t in = program[pc++];
-		if (mode1 == Mode::Relative)
-			in += relativebase;
-		if (mode1 != Mode::Immediate)
-			in = program[in];
-		relativebase += in;
-		return State::Run;
-	}
-
-	case Opcode::Halt:
-	{
-		// HALT
-		--pc;
-		return State::Halt;
-	}
-
-	default:
-	{
-		// ERROR
-		--pc;
-		return State::Error;
-	}
-	}
-}
-
-void BuildMap(const std::map<int64_t, int64_t>& program, std::string& map, Point& size, Point& position, Direction& direction)
+void BuildMap(const PagedMemory<int64_t>& program, std::string& map, Point& size, Point& position, Direction& direction)
 {
-	std::map<int64_t, int64_t> memory = program;
-
-	std::vector<int64_t> input, output;
+	Computer<int64_t> computer(program);
+	computer.Run();
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
-	State state = State::Run;
-	do
-	{
-		state = RunInstruction(memory, input, output, pc, relativebase);
-	} while (state == State::Run);
+	const std::vector<int64_t> output = computer.Drain();
 
 	map.clear();
 	map.reserve(output.size());
@@ -336,7 +108,7 @@ void BuildMap(const std::map<int64_t, int64_t>& program, std::string& map, Point
 }
 
 // PART 1
-void Part1(const std::map<int64_t, int64_t>& program, std::string& map, Point size, Point position, Direction direction)
+void Part1(const PagedMemory<int64_t>& program, std::string& map, Point size, Point position, Direction direction)
 {
 	// find intersections
 	int sum = 0;
@@ -365,7 +137,7 @@ Point directionstep[int(Direction::Count)]
 };
 
 // PART 2
-void Part2(const std::map<int64_t, int64_t>& program, const std::string& map, Point size, Point position, Direction direction)
+void Part2(const PagedMemory<int64_t>& program, const std::string& map, Point size, Point position, Direction direction)
 {
 	std::ostringstream commandstream;
 
@@ -439,12 +211,12 @@ void Part2(const std::map<int64_t, int64_t>& program, const std::string& map, Po
 	commandstream << std::endl;
 	std::cout << commandstream.str();
 
-	std::map<int64_t, int64_t> memory = program;
+	Computer<int64_t> computer(program);
 
 	// wake up the vacuum robot
-	memory[0] = 2;
+	computer.memory[0] = 2;
 
-	std::vector<int64_t> input, output;
+	Channel<int64_t>& output = computer.output;
 
 	// TODO: figure out how to compress the command list automatically
 	std::string compressed =
@@ -453,29 +225,23 @@ void Part2(const std::map<int64_t, int64_t>& program, const std::string& map, Po
 		"L,6,L,4,R,8,R,8\n"
 		"L,6,R,8,L,10,L,8,L,8\n"
 		"n\n";
-	for (const char c : compressed)
-		input.push_back(c);
+	computer.Feed(compressed.begin(), compressed.end());
 
-	int64_t pc = 0;
-	int64_t relativebase = 0;
-	State state = State::Run;
-	do
+	while (computer.RunUntil(1) == State::Output)
 	{
-		state = RunInstruction(memory, input, output, pc, relativebase);
-		if (!output.empty() && output[0] < 128)
+		if (output[0] < 128)
 		{
 			std::cout << char(output[0]);
 			output.clear();
 		}
 	}
-	while (state == State::Run);
 
 	std::cout << "Part 2: " << output[0] << " dust" << std::endl;
 }
 
 int main()
 {
-	std::map<int64_t, int64_t> program;
+	PagedMemory<int64_t> program;
 	ReadInput(program, std::cin);
 
 	std::string map;
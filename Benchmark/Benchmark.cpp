@@ -0,0 +1,703 @@
+// Intcode benchmarks
+//
+// parse: times ReadInput on a synthetic program of the given size in
+// megabytes (8 by default), read from memory so the disk is out of the
+// picture.  It parses into both memory backends, and compares them with
+// the getline and stringstream parsing ReadInput used to do and with
+// loading the same program from an image (see Image.h), which it writes to
+// Benchmark.img in the working directory and removes afterwards.
+//
+// run: times whole programs through each memory backend and dispatch
+// strategy, writing the results as JSON.  The corpus is the inputs of days
+// 05, 09, 11, 13, 15 and 17, found under the given directory (the parent of
+// the working directory by default), and two long-running kernels written
+// here, a prime sieve and a pair of nested loops.  Each program is run once
+// with its host on the counting interpreter, recording its input (see
+// InputLog.h), and the timed runs replay the recording, so they measure the
+// computer alone and know how many instructions they ran.  Every run starts
+// from a fresh computer, so decoding and compiling are part of the time.
+// Cycles are time-stamp counter cycles, where the processor has one, and
+// peak RSS is the process's, reset before each measurement where the system
+// allows it.
+//
+// usage: Benchmark parse [megabytes]
+//        Benchmark run [directory] [results.json]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <iomanip>
+#include <functional>
+#include <initializer_list>
+
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Image.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCHMARK_CYCLES 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCHMARK_CYCLES 1
+#else
+#define BENCHMARK_CYCLES 0
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// runs of each measurement, of which the fastest is reported
+constexpr int Repeats = 5;
+
+// program text of about the given size, in the mix of words real programs
+// have: instructions with their modes, small operands, negative offsets and
+// the odd large constant
+std::string SyntheticProgram(size_t bytes)
+{
+	std::string text;
+	text.reserve(bytes + 32);
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+	while (text.size() < bytes)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		const uint64_t random = state >> 33;
+		int64_t word;
+		switch (random % 8)
+		{
+		case 0:
+		case 1:
+			word = int64_t(random / 8 % 3) * 10000 + int64_t(random / 32 % 3) * 1000 + int64_t(random / 128 % 3) * 100 + int64_t(random / 512 % 9) + 1;
+			break;
+		case 2:
+			word = -int64_t(random / 8 % 1000);
+			break;
+		case 3:
+			word = int64_t(random / 8) * 104729;
+			break;
+		default:
+			word = int64_t(random / 8 % 2048);
+			break;
+		}
+		if (!text.empty())
+			text += ',';
+		text += std::to_string(word);
+	}
+	text += '\n';
+	return text;
+}
+
+// how ReadInput used to parse, for comparison
+void ReadInputStringstream(std::vector<int64_t>& output, std::istream& input)
+{
+	std::string entry;
+	while (std::getline(input, entry, ','))
+	{
+		std::stringstream sstream(entry);
+		int64_t value;
+		sstream >> value;
+		output.push_back(value);
+	}
+}
+
+// sum of the words, to check the parsers agree
+template<typename Memory>
+int64_t Checksum(const Memory& memory)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < memory.size(); ++i)
+		sum = sum * 31 + uint64_t(memory.data()[i]);
+	return int64_t(sum);
+}
+
+// time a parser over the text, reporting the fastest of several runs
+template<typename Memory, typename Parse>
+void TimeParse(const char* name, const std::string& text, Parse parse)
+{
+	double best = 1e30;
+	size_t words = 0;
+	int64_t checksum = 0;
+	for (int r = 0; r < Repeats; ++r)
+	{
+		std::istringstream input(text);
+		Memory memory;
+		const Clock::time_point start = Clock::now();
+		parse(memory, input);
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		best = std::min(best, seconds);
+		words = memory.size();
+		checksum = Checksum(memory);
+	}
+
+	std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(10) << double(text.size()) / best / 1e6 << " MB/s"
+		<< std::setw(10) << double(words) / best / 1e6 << " Mwords/s"
+		<< std::setw(12) << words << " words, checksum " << checksum << std::endl;
+}
+
+int Parse(size_t megabytes)
+{
+	const std::string text = SyntheticProgram(megabytes << 20);
+	std::cout << "parsing " << text.size() << " bytes, from_chars " << (INTCODE_FROM_CHARS ? "on" : "off") << std::endl;
+
+	TimeParse<std::vector<int64_t>>("getline/stringstream", text, ReadInputStringstream);
+	TimeParse<std::vector<int64_t>>("ReadInput vector", text, ReadInput<std::vector<int64_t>>);
+	TimeParse<PagedMemory<int64_t>>("ReadInput paged", text, ReadInput<PagedMemory<int64_t>>);
+
+	const std::string path = "Benchmark.img";
+	std::vector<int64_t> program;
+	std::istringstream input(text);
+	ReadInput(program, input);
+	if (!WriteImage(path, program, 8, false))
+	{
+		std::cerr << "cannot write " << path << std::endl;
+		return 1;
+	}
+	TimeParse<std::vector<int64_t>>("ReadImage vector", text, [&path](std::vector<int64_t>& memory, std::istream&) { ReadImage(memory, path); });
+	TimeParse<PagedMemory<int64_t>>("ReadImage paged", text, [&path](PagedMemory<int64_t>& memory, std::istream&) { ReadImage(memory, path); });
+	std::remove(path.c_str());
+	return 0;
+}
+
+// shortest time to spend measuring each configuration, and fewest runs
+constexpr double MinimumSeconds = 0.25;
+constexpr int MinimumRuns = 3;
+
+// an Intcode program written here, with cells for its variables, an array
+// after them, and labels for jumps
+class Kernel
+{
+public:
+	struct Operand
+	{
+		enum class Kind { Immediate, Variable, Label, Array } kind;
+		int64_t value;
+	};
+
+	static Operand Value(int64_t value)
+	{
+		return { Operand::Kind::Immediate, value };
+	}
+
+	// a variable's cell
+	static Operand Cell(int variable)
+	{
+		return { Operand::Kind::Variable, variable };
+	}
+
+	// the address of a label, as an immediate jump target
+	static Operand At(int label)
+	{
+		return { Operand::Kind::Label, label };
+	}
+
+	// the array element at the relative base
+	static Operand Element()
+	{
+		return { Operand::Kind::Array, 0 };
+	}
+
+	void Emit(Opcode opcode, std::initializer_list<Operand> operands)
+	{
+		int64_t word = int64_t(opcode);
+		int64_t scale = 100;
+		for (const Operand& operand : operands)
+		{
+			switch (operand.kind)
+			{
+			case Operand::Kind::Immediate:
+			case Operand::Kind::Label:
+				word += int64_t(Mode::Immediate) * scale;
+				break;
+			case Operand::Kind::Array:
+				word += int64_t(Mode::Relative) * scale;
+				break;
+			default:
+				break;
+			}
+			scale *= 10;
+		}
+		code.push_back(word);
+		for (const Operand& operand : operands)
+		{
+			fixups.push_back({ code.size(), operand });
+			code.push_back(operand.value);
+		}
+	}
+
+	void Mark(int label)
+	{
+		labels[label] = int64_t(code.size());
+	}
+
+	// the program, with the variables and the array after the code
+	std::vector<int64_t> Link(int variables, size_t array) const
+	{
+		std::vector<int64_t> program = code;
+		const int64_t cells = int64_t(program.size());
+		for (const Fixup& fixup : fixups)
+		{
+			switch (fixup.operand.kind)
+			{
+			case Operand::Kind::Variable:
+				program[fixup.address] = cells + fixup.operand.value;
+				break;
+			case Operand::Kind::Label:
+				program[fixup.address] = labels.at(int(fixup.operand.value));
+				break;
+			case Operand::Kind::Array:
+				program[fixup.address] = cells + variables;
+				break;
+			default:
+				break;
+			}
+		}
+		program.resize(program.size() + size_t(variables) + array, 0);
+		return program;
+	}
+
+private:
+	struct Fixup
+	{
+		size_t address;
+		Operand operand;
+	};
+
+	std::vector<int64_t> code;
+	std::vector<Fixup> fixups;
+	std::map<int, int64_t> labels;
+};
+
+// count the primes below a limit with the sieve of Eratosthenes, indexing
+// the sieve through the relative base
+std::vector<int64_t> Sieve(int64_t limit)
+{
+	enum { i, j, negative, test, count, Variables };
+	enum { Outer, Inner, Next, End };
+	using K = Kernel;
+
+	Kernel k;
+	k.Emit(Opcode::Add, { K::Value(2), K::Value(0), K::Cell(i) });
+	k.Mark(Outer);
+	k.Emit(Opcode::LessThan, { K::Cell(i), K::Value(limit), K::Cell(test) });
+	k.Emit(Opcode::JumpIfFalse, { K::Cell(test), K::At(End) });
+
+	// is sieve[i] still clear?
+	k.Emit(Opcode::Multiply, { K::Cell(i), K::Value(-1), K::Cell(negative) });
+	k.Emit(Opcode::RelativeBaseOffset, { K::Cell(i) });
+	k.Emit(Opcode::Equals, { K::Element(), K::Value(0), K::Cell(test) });
+	k.Emit(Opcode::RelativeBaseOffset, { K::Cell(negative) });
+	k.Emit(Opcode::JumpIfFalse, { K::Cell(test), K::At(Next) });
+
+	// a prime: strike out its multiples from its square
+	k.Emit(Opcode::Add, { K::Cell(count), K::Value(1), K::Cell(count) });
+	k.Emit(Opcode::Multiply, { K::Cell(i), K::Cell(i), K::Cell(j) });
+	k.Mark(Inner);
+	k.Emit(Opcode::LessThan, { K::Cell(j), K::Value(limit), K::Cell(test) });
+	k.Emit(Opcode::JumpIfFalse, { K::Cell(test), K::At(Next) });
+	k.Emit(Opcode::Multiply, { K::Cell(j), K::Value(-1), K::Cell(negative) });
+	k.Emit(Opcode::RelativeBaseOffset, { K::Cell(j) });
+	k.Emit(Opcode::Add, { K::Value(1), K::Value(0), K::Element() });
+	k.Emit(Opcode::RelativeBaseOffset, { K::Cell(negative) });
+	k.Emit(Opcode::Add, { K::Cell(j), K::Cell(i), K::Cell(j) });
+	k.Emit(Opcode::JumpIfTrue, { K::Value(1), K::At(Inner) });
+
+	k.Mark(Next);
+	k.Emit(Opcode::Add, { K::Cell(i), K::Value(1), K::Cell(i) });
+	k.Emit(Opcode::JumpIfTrue, { K::Value(1), K::At(Outer) });
+
+	k.Mark(End);
+	k.Emit(Opcode::Output, { K::Cell(count) });
+	k.Emit(Opcode::Halt, {});
+	return k.Link(Variables, size_t(limit));
+}
+
+// sum i * j over a square of loop counters
+std::vector<int64_t> NestedLoops(int64_t size)
+{
+	enum { i, j, product, sum, test, Variables };
+	enum { Outer, Inner, Next, End };
+	using K = Kernel;
+
+	Kernel k;
+	k.Mark(Outer);
+	k.Emit(Opcode::LessThan, { K::Cell(i), K::Value(size), K::Cell(test) });
+	k.Emit(Opcode::JumpIfFalse, { K::Cell(test), K::At(End) });
+	k.Emit(Opcode::Add, { K::Value(0), K::Value(0), K::Cell(j) });
+	k.Mark(Inner);
+	k.Emit(Opcode::LessThan, { K::Cell(j), K::Value(size), K::Cell(test) });
+	k.Emit(Opcode::JumpIfFalse, { K::Cell(test), K::At(Next) });
+	k.Emit(Opcode::Multiply, { K::Cell(i), K::Cell(j), K::Cell(product) });
+	k.Emit(Opcode::Add, { K::Cell(sum), K::Cell(product), K::Cell(sum) });
+	k.Emit(Opcode::Add, { K::Cell(j), K::Value(1), K::Cell(j) });
+	k.Emit(Opcode::JumpIfTrue, { K::Value(1), K::At(Inner) });
+	k.Mark(Next);
+	k.Emit(Opcode::Add, { K::Cell(i), K::Value(1), K::Cell(i) });
+	k.Emit(Opcode::JumpIfTrue, { K::Value(1), K::At(Outer) });
+	k.Mark(End);
+	k.Emit(Opcode::Output, { K::Cell(sum) });
+	k.Emit(Opcode::Halt, {});
+	return k.Link(Variables, 0);
+}
+
+// drives a program the way its day does, while its input is recorded
+using Host = std::function<void(Computer<int64_t>& computer, InputLog& log)>;
+
+// a program, and what running it with its host recorded
+struct Workload
+{
+	std::string name;
+	std::vector<int64_t> program;
+	InputLog log;
+
+	// one past the highest address the program used, so that a plain vector
+	// can be made large enough
+	size_t extent = 0;
+};
+
+Workload Record(const std::string& name, const std::vector<int64_t>& program, const Host& host)
+{
+	Workload workload;
+	workload.name = name;
+	workload.program = program;
+
+	PagedMemory<int64_t> memory;
+	for (const int64_t word : program)
+		memory.push_back(word);
+	Computer<int64_t> computer(memory);
+	computer.recording = &workload.log;
+	host(computer, workload.log);
+
+	workload.extent = computer.memory.size();
+	computer.memory.VisitPages([&workload](int64_t address, const int64_t*, size_t count)
+	{
+		if (address >= 0)
+			workload.extent = std::max(workload.extent, size_t(address) + count);
+	});
+	return workload;
+}
+
+// feed the given values, then run to the end
+Host Inputs(std::initializer_list<int64_t> values)
+{
+	const std::vector<int64_t> inputs = values;
+	return [inputs](Computer<int64_t>& computer, InputLog&)
+	{
+		computer.Feed(inputs.begin(), inputs.end());
+		computer.Run();
+	};
+}
+
+// day 11: the painting robot, starting on a black panel
+void Paint(Computer<int64_t>& computer, InputLog&)
+{
+	std::map<std::pair<int, int>, int64_t> hull;
+	int x = 0, y = 0, direction = 0;
+	const int dx[] = { 0, 1, 0, -1 };
+	const int dy[] = { -1, 0, 1, 0 };
+	for (;;)
+	{
+		computer.Feed(hull[{ x, y }]);
+		if (computer.RunUntil(2) != State::Output)
+			break;
+		const std::vector<int64_t> values = computer.Drain();
+		hull[{ x, y }] = values[0];
+		direction = (direction + (values[1] ? 1 : 3)) % 4;
+		x += dx[direction];
+		y += dy[direction];
+	}
+}
+
+// day 13: play the game with quarters, keeping the paddle under the ball
+void Play(Computer<int64_t>& computer, InputLog& log)
+{
+	computer.Poke(0, 2);
+	log.Poke(0, 2);
+	int64_t ball = 0, paddle = 0;
+	for (;;)
+	{
+		const State state = computer.RunUntil(3);
+		if (state == State::Wait)
+		{
+			computer.Feed(ball > paddle ? 1 : ball < paddle ? -1 : 0);
+			continue;
+		}
+		if (state != State::Output)
+			break;
+		const std::vector<int64_t> values = computer.Drain();
+		if (values[2] == 4)
+			ball = values[0];
+		else if (values[2] == 3)
+			paddle = values[0];
+	}
+}
+
+// day 15: follow the right-hand wall of the maze for a few thousand moves
+// (the program never halts, so the host decides when to stop)
+void Explore(Computer<int64_t>& computer, InputLog&)
+{
+	// north, east, south and west, clockwise
+	const int64_t command[] = { 1, 4, 2, 3 };
+	int heading = 0;
+	int attempt = 1;
+	for (int moves = 0; moves < 4000; ++moves)
+	{
+		computer.Feed(command[attempt]);
+		if (computer.RunUntil(1) != State::Output)
+			break;
+		if (computer.output.Pop() == 0)
+		{
+			// a wall: try further to the left
+			attempt = (attempt + 3) % 4;
+		}
+		else
+		{
+			heading = attempt;
+			attempt = (heading + 1) % 4;
+		}
+	}
+}
+
+// the corpus; false if a day's input cannot be read
+bool Corpus(const std::string& directory, std::vector<Workload>& workloads)
+{
+	struct Day
+	{
+		const char* name;
+		Host host;
+	};
+	const Day days[] =
+	{
+		{ "05", Inputs({ 5 }) },
+		{ "09", Inputs({ 2 }) },
+		{ "11", Paint },
+		{ "13", Play },
+		{ "15", Explore },
+		{ "17", Inputs({}) },
+	};
+
+	for (const Day& day : days)
+	{
+		std::ifstream input(directory + "/" + day.name + "/input.txt");
+		if (!input)
+		{
+			std::cerr << "no input for day " << day.name << " under " << directory << std::endl;
+			return false;
+		}
+		std::vector<int64_t> program;
+		ReadInput(program, input);
+		workloads.push_back(Record(day.name, program, day.host));
+	}
+
+	workloads.push_back(Record("sieve", Sieve(200000), Inputs({})));
+	workloads.push_back(Record("loops", NestedLoops(1000), Inputs({})));
+	return true;
+}
+
+// start a new peak for the resident set, where the system allows it
+void ResetPeakMemory()
+{
+#ifdef __linux__
+	std::ofstream clear("/proc/self/clear_refs");
+	clear << "5";
+#endif
+}
+
+// peak resident set in kilobytes
+uint64_t PeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return uint64_t(counters.PeakWorkingSetSize) / 1024;
+#elif defined(__linux__)
+	// the high-water mark clear_refs resets; ru_maxrss never goes down
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, 6, "VmHWM:") == 0)
+			return std::strtoull(line.c_str() + 6, nullptr, 10);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return uint64_t(usage.ru_maxrss) / 1024;
+#else
+	return uint64_t(usage.ru_maxrss);
+#endif
+#endif
+}
+
+uint64_t Cycles()
+{
+#if BENCHMARK_CYCLES
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// a workload's program in a memory backend
+void MakeMemory(PagedMemory<int64_t>& memory, const Workload& workload)
+{
+	for (const int64_t word : workload.program)
+		memory.push_back(word);
+}
+void MakeMemory(std::vector<int64_t>& memory, const Workload& workload)
+{
+	memory = workload.program;
+	memory.resize(std::max(memory.size(), workload.extent), 0);
+}
+
+struct Result
+{
+	uint64_t runs;
+	double seconds;		// of the fastest run
+	uint64_t cycles;	// of the fastest run
+	uint64_t peak;		// kilobytes
+	bool ok;			// every run matched the recording
+};
+
+// replay a workload until enough time has gone by
+template<typename Memory>
+Result Measure(const Workload& workload, Dispatch dispatch)
+{
+	Memory program;
+	MakeMemory(program, workload);
+
+	ResetPeakMemory();
+	Result result = { 0, 1e30, 0, 0, true };
+	double total = 0;
+	while (total < MinimumSeconds || result.runs < MinimumRuns)
+	{
+		Computer<int64_t, Memory> computer(program);
+		computer.dispatch = dispatch;
+
+		const uint64_t cycles = Cycles();
+		const Clock::time_point start = Clock::now();
+		workload.log.Replay(computer);
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const uint64_t elapsed = Cycles() - cycles;
+
+		result.ok = result.ok && workload.log.Matches(computer.Drain());
+		if (seconds < result.seconds)
+		{
+			result.seconds = seconds;
+			result.cycles = elapsed;
+		}
+		total += seconds;
+		++result.runs;
+	}
+	result.peak = PeakMemory();
+	return result;
+}
+
+void WriteResult(std::ostream& out, const Workload& workload, const char* memory, Dispatch dispatch, const Result& result)
+{
+	const uint64_t instructions = workload.log.Instructions();
+	out << "    { \"workload\": \"" << workload.name << "\", \"memory\": \"" << memory << "\", \"dispatch\": \"" << DispatchName(dispatch) << "\""
+		<< ", \"instructions\": " << instructions
+		<< ", \"runs\": " << result.runs
+		<< std::setprecision(9) << ", \"seconds\": " << result.seconds
+		<< std::setprecision(4) << ", \"instructions_per_second\": " << double(instructions) / result.seconds
+		<< ", \"ns_per_instruction\": " << result.seconds * 1e9 / double(instructions);
+	if (BENCHMARK_CYCLES)
+		out << ", \"cycles_per_instruction\": " << double(result.cycles) / double(instructions);
+	else
+		out << ", \"cycles_per_instruction\": null";
+	out << ", \"peak_rss_kb\": " << result.peak
+		<< ", \"ok\": " << (result.ok ? "true" : "false") << " }";
+}
+
+int Run(const std::string& directory, const std::string& path)
+{
+	std::vector<Workload> workloads;
+	if (!Corpus(directory, workloads))
+		return 1;
+
+	std::ofstream file;
+	if (!path.empty())
+	{
+		file.open(path);
+		if (!file)
+		{
+			std::cerr << "cannot write " << path << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = path.empty() ? std::cout : file;
+
+	// profiling builds always run the switch interpreter
+	std::vector<Dispatch> strategies = { Dispatch::Switch };
+	if (INTCODE_THREADED && !INTCODE_PROFILE)
+		strategies.push_back(Dispatch::Threaded);
+	if (INTCODE_JIT && !INTCODE_PROFILE)
+		strategies.push_back(Dispatch::Native);
+
+	out << "{" << std::endl;
+	out << "  \"build\": { \"fusion\": " << (INTCODE_FUSION ? "true" : "false")
+		<< ", \"threaded\": " << (INTCODE_THREADED ? "true" : "false")
+		<< ", \"jit\": " << (INTCODE_JIT ? "true" : "false")
+		<< ", \"profile\": " << (INTCODE_PROFILE ? "true" : "false") << " }," << std::endl;
+	out << "  \"results\": [" << std::endl;
+
+	bool first = true;
+	bool ok = true;
+	auto write = [&](const Workload& workload, const char* memory, Dispatch dispatch, const Result& result)
+	{
+		if (!first)
+			out << "," << std::endl;
+		first = false;
+		WriteResult(out, workload, memory, dispatch, result);
+		out.flush();
+		ok = ok && result.ok;
+		if (!result.ok)
+			std::cerr << workload.name << " on " << memory << " memory with " << DispatchName(dispatch) << " dispatch did not match its recording" << std::endl;
+	};
+
+	for (const Workload& workload : workloads)
+	{
+		for (const Dispatch dispatch : strategies)
+		{
+			write(workload, "paged", dispatch, Measure<PagedMemory<int64_t>>(workload, dispatch));
+
+			// only paged memory can be compiled
+			if (dispatch != Dispatch::Native)
+				write(workload, "vector", dispatch, Measure<std::vector<int64_t>>(workload, dispatch));
+		}
+	}
+
+	out << std::endl << "  ]" << std::endl << "}" << std::endl;
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "parse")
+		return Parse(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8);
+	if (mode == "run")
+		return Run(argc > 2 ? argv[2] : "..", argc > 3 ? argv[3] : "");
+
+	std::cerr << "usage: Benchmark parse [megabytes]" << std::endl;
+	std::cerr << "       Benchmark run [directory] [results.json]" << std::endl;
+	return 1;
+}
@@ -0,0 +1,35 @@
+// Intcode disassembler
+//
+// Reads an Intcode program from the standard input and writes what static
+// analysis finds in it (see Intcode/Analysis.h) to the standard output: its
+// basic blocks with their instructions, the relative base where it is known
+// and the blocks each one leads to, then its loops, innermost first, the
+// runs of memory that are data, and any writes the analysis cannot place.
+//
+// usage: Disassemble < input.txt
+
+#include <iostream>
+#include <vector>
+
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Analysis.h"
+
+int main()
+{
+	std::vector<int64_t> program;
+	if (!ReadInput(program, std::cin))
+	{
+		std::cerr << "the standard input holds something that is not an Intcode word" << std::endl;
+		return 1;
+	}
+	if (program.empty())
+	{
+		std::cerr << "no program on the standard input" << std::endl;
+		return 1;
+	}
+
+	const Analysis analysis(program);
+	analysis.Write(std::cout);
+
+	return 0;
+}
@@ -0,0 +1,594 @@
+#include "Analysis.h"
+#include "Intcode.h"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	// most instructions decoded from an address that only looks like code
+	const int MaxGuessed = 64;
+
+	bool IsJump(Opcode opcode)
+	{
+		return opcode == Opcode::JumpIfTrue || opcode == Opcode::JumpIfFalse;
+	}
+
+	// the parameter an instruction writes, or 0 if it writes nothing
+	int WrittenParameter(Opcode opcode)
+	{
+		switch (opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			return 3;
+		case Opcode::Input:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	// relative base on entry to a block while propagating
+	enum class Base : uint8_t
+	{
+		Unseen,
+		Known,
+		Unknown,
+	};
+}
+
+Analysis::Analysis(std::vector<int64_t> program)
+	: image(std::move(program))
+	, flags(image.size(), 0)
+{
+	Sweep();
+	Descend();
+	Split();
+	Propagate();
+	Resolve();
+	FindLoops();
+}
+
+// the instruction at an address decodes as a known opcode that fits in the image
+bool Analysis::Valid(int64_t address) const
+{
+	if (address < 0 || uint64_t(address) >= image.size())
+		return false;
+	const Instruction<int64_t> i = Decode(image[size_t(address)]);
+	if (i.opcode == Opcode(0))
+		return false;
+	return size_t(address) + InstructionLength(i.opcode) <= image.size();
+}
+
+// decode every word in turn, stepping over instructions and single words
+// that do not decode
+void Analysis::Sweep()
+{
+	for (int64_t address = 0; uint64_t(address) < image.size(); )
+	{
+		if (!Valid(address))
+		{
+			++address;
+			continue;
+		}
+		flags[size_t(address)] |= Swept;
+		address += InstructionLength(Decode(image[size_t(address)]).opcode);
+	}
+}
+
+// follow straight-line code from an address, collecting the instructions
+// visited, their immediate jump targets, and their other immediate operands
+// (a guessed walk fails if it runs into something that is not code, or into
+// the middle of an instruction)
+bool Analysis::Walk(int64_t address, bool guess, std::vector<int64_t>& visited, std::vector<int64_t>& targets, std::vector<int64_t>& operands) const
+{
+	for (int count = 0; !guess || count < MaxGuessed; ++count)
+	{
+		if (!Valid(address))
+			return !guess;
+
+		// stop at code that has already been found, and give up on a guess
+		// that lands inside it
+		const uint8_t mark = flags[size_t(address)];
+		if ((mark & Start) && (guess || !(mark & Guessed)))
+			return true;
+		if (guess && (mark & Code))
+			return false;
+
+		visited.push_back(address);
+		const Instruction<int64_t> i = Decode(image[size_t(address)]);
+		const int length = InstructionLength(i.opcode);
+		const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+		for (int p = 1; p < length; ++p)
+		{
+			if (modes[p - 1] == Mode::Immediate)
+				(IsJump(i.opcode) && p == 2 ? targets : operands).push_back(image[size_t(address) + p]);
+		}
+
+		if (i.opcode == Opcode::Halt)
+			return true;
+
+		// a jump on a constant that is always taken ends the block
+		if (IsJump(i.opcode) && i.mode1 == Mode::Immediate && (image[size_t(address) + 1] != 0) == (i.opcode == Opcode::JumpIfTrue))
+			return true;
+
+		address += length;
+	}
+	return true;
+}
+
+// find everything reachable from address 0 through constant jumps, then code
+// guessed from immediate operands
+void Analysis::Descend()
+{
+	std::vector<int64_t> reachable(1, 0);
+	std::vector<int64_t> guessed;
+	while (!reachable.empty() || !guessed.empty())
+	{
+		const bool guess = reachable.empty();
+		std::vector<int64_t>& pending = guess ? guessed : reachable;
+		const int64_t address = pending.back();
+		pending.pop_back();
+
+		std::vector<int64_t> visited, targets, operands;
+		if (!Walk(address, guess, visited, targets, operands) || visited.empty())
+			continue;
+
+		if (guess)
+			guesses.push_back(address);
+		for (const int64_t start : visited)
+		{
+			uint8_t& mark = flags[size_t(start)];
+			mark = guess ? mark | Start | Guessed : (mark | Start) & ~Guessed;
+			const int length = InstructionLength(Decode(image[size_t(start)]).opcode);
+			for (int w = 0; w < length; ++w)
+				flags[size_t(start) + w] |= Code;
+		}
+
+		for (const int64_t target : targets)
+			(guess ? guessed : reachable).push_back(target);
+		guessed.insert(guessed.end(), operands.begin(), operands.end());
+	}
+
+	std::sort(guesses.begin(), guesses.end());
+	guesses.erase(std::unique(guesses.begin(), guesses.end()), guesses.end());
+}
+
+// cut the code into basic blocks and join them up
+void Analysis::Split()
+{
+	// blocks start at the entry point, jump targets, guessed entry points,
+	// and after jumps and halts
+	std::vector<uint8_t> leader(image.size() + 1, 0);
+	if (!image.empty())
+		leader[0] = 1;
+	for (const int64_t guess : guesses)
+		leader[size_t(guess)] = 1;
+	for (size_t address = 0; address < image.size(); ++address)
+	{
+		if (!(flags[address] & Start))
+			continue;
+		const Instruction<int64_t> i = Decode(image[address]);
+		const size_t next = address + InstructionLength(i.opcode);
+		if (IsJump(i.opcode) || i.opcode == Opcode::Halt)
+			leader[next] = 1;
+		if (IsJump(i.opcode) && i.mode2 == Mode::Immediate)
+		{
+			const int64_t target = image[address + 2];
+			if (target >= 0 && uint64_t(target) < image.size())
+				leader[size_t(target)] = 1;
+		}
+	}
+
+	for (size_t address = 0; address < image.size(); ++address)
+	{
+		if (!(flags[address] & Start))
+			continue;
+		if (blocks.empty() || leader[address] || blocks.back().end != int64_t(address))
+			blocks.push_back({ int64_t(address), int64_t(address), Exit::Fall, (flags[address] & Guessed) != 0, false, 0, 0, {}, {} });
+		blocks.back().end = int64_t(address) + InstructionLength(Decode(image[address]).opcode);
+	}
+
+	for (size_t b = 0; b < blocks.size(); ++b)
+	{
+		Block& block = blocks[b];
+
+		// the last instruction decides the way out
+		int64_t last = block.start;
+		while (last + InstructionLength(Decode(image[size_t(last)]).opcode) < block.end)
+			last += InstructionLength(Decode(image[size_t(last)]).opcode);
+		const Instruction<int64_t> i = Decode(image[size_t(last)]);
+
+		bool falls = true;
+		if (i.opcode == Opcode::Halt)
+		{
+			block.exit = Exit::Halt;
+			falls = false;
+		}
+		else if (IsJump(i.opcode))
+		{
+			const bool constant = i.mode1 == Mode::Immediate;
+			const bool taken = (image[size_t(last) + 1] != 0) == (i.opcode == Opcode::JumpIfTrue);
+			if (constant && !taken)
+				block.exit = Exit::Fall;
+			else
+			{
+				if (i.mode2 != Mode::Immediate)
+					block.exit = Exit::Computed;
+				else
+				{
+					block.exit = constant ? Exit::Jump : Exit::Branch;
+					const size_t target = BlockAt(image[size_t(last) + 2]);
+					if (target != NoBlock && blocks[target].start == image[size_t(last) + 2])
+						block.successors.push_back(target);
+				}
+				falls = !constant;
+			}
+		}
+
+		if (falls)
+		{
+			const size_t next = BlockAt(block.end);
+			if (next != NoBlock)
+				block.successors.push_back(next);
+			else if (block.exit == Exit::Fall)
+				block.exit = Exit::Fault;
+		}
+
+		std::sort(block.successors.begin(), block.successors.end());
+		block.successors.erase(std::unique(block.successors.begin(), block.successors.end()), block.successors.end());
+	}
+
+	for (size_t b = 0; b < blocks.size(); ++b)
+	{
+		for (const size_t successor : blocks[b].successors)
+			blocks[successor].predecessors.push_back(b);
+	}
+}
+
+size_t Analysis::BlockAt(int64_t address) const
+{
+	auto itor = std::upper_bound(blocks.begin(), blocks.end(), address, [](int64_t a, const Block& block) { return a < block.start; });
+	if (itor == blocks.begin())
+		return NoBlock;
+	--itor;
+	return address < itor->end ? size_t(itor - blocks.begin()) : NoBlock;
+}
+
+// propagate the relative base through the graph until nothing changes
+void Analysis::Propagate()
+{
+	std::vector<Base> state(blocks.size(), Base::Unseen);
+	std::vector<size_t> pending;
+
+	auto join = [&](size_t b, bool known, int64_t base)
+	{
+		Block& block = blocks[b];
+		Base next = state[b];
+		if (state[b] == Base::Unseen)
+			next = known ? Base::Known : Base::Unknown;
+		else if (state[b] == Base::Known && (!known || block.base != base))
+			next = Base::Unknown;
+		if (next == state[b])
+			return;
+		state[b] = next;
+		block.base = base;
+		pending.push_back(b);
+	};
+
+	if (!blocks.empty() && blocks[0].start == 0)
+		join(0, true, 0);
+
+	while (!pending.empty())
+	{
+		const size_t b = pending.back();
+		pending.pop_back();
+
+		bool known = state[b] == Base::Known;
+		int64_t base = blocks[b].base;
+		for (int64_t address = blocks[b].start; address < blocks[b].end; )
+		{
+			const Instruction<int64_t> i = Decode(image[size_t(address)]);
+			const int length = InstructionLength(i.opcode);
+			const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+
+			// a pushed return address starts with the base of the code pushing it
+			for (int p = 1; p < length; ++p)
+			{
+				const int64_t value = image[size_t(address) + p];
+				if (modes[p - 1] == Mode::Immediate && !(IsJump(i.opcode) && p == 2) && std::binary_search(guesses.begin(), guesses.end(), value))
+				{
+					const size_t target = BlockAt(value);
+					if (target != NoBlock)
+						join(target, known, base);
+				}
+			}
+
+			if (i.opcode == Opcode::RelativeBaseOffset)
+			{
+				if (i.mode1 == Mode::Immediate)
+					base += image[size_t(address) + 1];
+				else
+					known = false;
+			}
+			address += length;
+		}
+
+		for (const size_t successor : blocks[b].successors)
+			join(successor, known, base);
+	}
+
+	for (size_t b = 0; b < blocks.size(); ++b)
+		blocks[b].baseKnown = state[b] == Base::Known;
+}
+
+bool Analysis::BaseAt(int64_t address, int64_t& base) const
+{
+	const size_t b = BlockAt(address);
+	if (b == NoBlock || !blocks[b].baseKnown)
+		return false;
+
+	base = blocks[b].base;
+	for (int64_t at = blocks[b].start; at < address; )
+	{
+		const Instruction<int64_t> i = Decode(image[size_t(at)]);
+		if (i.opcode == Opcode::RelativeBaseOffset)
+		{
+			if (i.mode1 != Mode::Immediate)
+				return false;
+			base += image[size_t(at) + 1];
+		}
+		at += InstructionLength(i.opcode);
+	}
+	return true;
+}
+
+// mark the addresses instructions read and write where they are known
+void Analysis::Resolve()
+{
+	for (const Block& block : blocks)
+	{
+		bool known = block.baseKnown;
+		int64_t base = block.base;
+		for (int64_t address = block.start; address < block.end; )
+		{
+			const Instruction<int64_t> i = Decode(image[size_t(address)]);
+			const int length = InstructionLength(i.opcode);
+			const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+			const int written = WrittenParameter(i.opcode);
+
+			for (int p = 1; p < length; ++p)
+			{
+				const Mode mode = modes[p - 1];
+				if (mode == Mode::Immediate && p != written)
+					continue;
+				if (mode == Mode::Relative && !known)
+				{
+					if (p == written)
+						unresolved.push_back(address);
+					continue;
+				}
+
+				const int64_t target = image[size_t(address) + p] + (mode == Mode::Relative ? base : 0);
+				if (target >= 0 && uint64_t(target) < image.size())
+					flags[size_t(target)] |= p == written ? Written : Read;
+			}
+
+			if (i.opcode == Opcode::RelativeBaseOffset)
+			{
+				if (i.mode1 == Mode::Immediate)
+					base += image[size_t(address) + 1];
+				else
+					known = false;
+			}
+			address += length;
+		}
+	}
+}
+
+// find the natural loops from the back edges of a depth-first search
+void Analysis::FindLoops()
+{
+	enum Visit : uint8_t
+	{
+		New,
+		Open,
+		Closed,
+	};
+	std::vector<uint8_t> visit(blocks.size(), New);
+	std::vector<std::pair<size_t, size_t>> backs;
+
+	// start from the entry point, then from whatever it does not reach
+	for (size_t root = 0; root < blocks.size(); ++root)
+	{
+		if (visit[root] != New)
+			continue;
+
+		std::vector<std::pair<size_t, size_t>> stack(1, { root, 0 });
+		visit[root] = Open;
+		while (!stack.empty())
+		{
+			const size_t b = stack.back().first;
+			const size_t s = stack.back().second++;
+			if (s == blocks[b].successors.size())
+			{
+				visit[b] = Closed;
+				stack.pop_back();
+				continue;
+			}
+
+			const size_t successor = blocks[b].successors[s];
+			if (visit[successor] == Open)
+				backs.push_back({ b, successor });
+			else if (visit[successor] == New)
+			{
+				visit[successor] = Open;
+				stack.push_back({ successor, 0 });
+			}
+		}
+	}
+
+	// the body of a loop is everything that reaches a back edge without
+	// passing through its header; back edges to the same header make one loop
+	std::sort(backs.begin(), backs.end(), [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) { return a.second < b.second; });
+	for (size_t e = 0; e < backs.size(); )
+	{
+		const size_t header = backs[e].second;
+		std::vector<uint8_t> inside(blocks.size(), 0);
+		inside[header] = 1;
+		std::vector<size_t> pending;
+		for (; e < backs.size() && backs[e].second == header; ++e)
+		{
+			if (!inside[backs[e].first])
+			{
+				inside[backs[e].first] = 1;
+				pending.push_back(backs[e].first);
+			}
+		}
+		while (!pending.empty())
+		{
+			const size_t b = pending.back();
+			pending.pop_back();
+			for (const size_t predecessor : blocks[b].predecessors)
+			{
+				if (!inside[predecessor])
+				{
+					inside[predecessor] = 1;
+					pending.push_back(predecessor);
+				}
+			}
+		}
+
+		Loop loop = { header, {} };
+		for (size_t b = 0; b < blocks.size(); ++b)
+		{
+			if (inside[b])
+			{
+				loop.blocks.push_back(b);
+				++blocks[b].depth;
+			}
+		}
+		loops.push_back(loop);
+	}
+
+	// innermost first: deepest header, then smallest body
+	std::sort(loops.begin(), loops.end(), [this](const Loop& a, const Loop& b)
+		{
+			if (blocks[a.header].depth != blocks[b.header].depth)
+				return blocks[a.header].depth > blocks[b.header].depth;
+			return a.blocks.size() < b.blocks.size();
+		}
+	);
+}
+
+std::vector<Analysis::Region> Analysis::DataRegions() const
+{
+	std::vector<Region> regions;
+	for (size_t address = 0; address < flags.size(); ++address)
+	{
+		if (flags[address] & Code)
+			continue;
+		if (!regions.empty() && regions.back().end == int64_t(address))
+			++regions.back().end;
+		else
+			regions.push_back({ int64_t(address), int64_t(address) + 1 });
+	}
+	return regions;
+}
+
+bool Analysis::WritesCode() const
+{
+	for (const uint8_t mark : flags)
+	{
+		if ((mark & Code) && (mark & Written))
+			return true;
+	}
+	return false;
+}
+
+void Analysis::Write(std::ostream& out) const
+{
+	const char* exits[] = { "fall", "jump", "branch", "computed", "halt", "fault" };
+
+	for (size_t b = 0; b < blocks.size(); ++b)
+	{
+		const Block& block = blocks[b];
+		out << "block " << b << " [" << block.start << ", " << block.end << ") " << exits[int(block.exit)];
+		if (block.guessed)
+			out << ", guessed";
+		if (block.baseKnown)
+			out << ", base " << block.base;
+		if (block.depth)
+			out << ", depth " << block.depth;
+		if (!block.successors.empty())
+		{
+			out << " ->";
+			for (const size_t successor : block.successors)
+				out << " " << successor;
+		}
+		out << std::endl;
+
+		for (int64_t address = block.start; address < block.end; )
+		{
+			const Instruction<int64_t> i = Decode(image[size_t(address)]);
+			const int length = InstructionLength(i.opcode);
+			const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+			int64_t base = 0;
+			const bool known = BaseAt(address, base);
+
+			out << "\t" << address << "\t" << OpcodeName(i.opcode);
+			for (int p = 1; p < length; ++p)
+			{
+				const int64_t value = image[size_t(address) + p];
+				out << (p == 1 ? " " : ", ");
+				switch (modes[p - 1])
+				{
+				case Mode::Position:
+					out << "[" << value << "]";
+					break;
+				case Mode::Relative:
+					out << "[base" << (value < 0 ? "" : "+") << value;
+					if (known)
+						out << " = " << base + value;
+					out << "]";
+					break;
+				default:
+					out << value;
+					break;
+				}
+			}
+			out << std::endl;
+			address += length;
+		}
+	}
+
+	out << std::endl << "loops:" << std::endl;
+	for (const Loop& loop : loops)
+		out << "\tblock " << loop.header << " at " << blocks[loop.header].start << ", " << loop.blocks.size() << " blocks, depth " << blocks[loop.header].depth << std::endl;
+
+	out << std::endl << "data:" << std::endl;
+	for (const Region& region : DataRegions())
+	{
+		// the sweep decoding instructions here means it could be dead code
+		int swept = 0;
+		for (int64_t address = region.start; address < region.end; ++address)
+			swept += (flags[size_t(address)] & Swept) != 0;
+		out << "\t[" << region.start << ", " << region.end << ")";
+		if (swept)
+			out << ", " << swept << " instructions by linear sweep";
+		out << std::endl;
+	}
+
+	if (!unresolved.empty())
+	{
+		out << std::endl << "writes through an unknown base:";
+		for (const int64_t address : unresolved)
+			out << " " << address;
+		out << std::endl;
+	}
+	if (WritesCode())
+		out << std::endl << "writes over its own code" << std::endl;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// Static analysis of an Intcode program image
+//
+// Analysis decodes a program without running it, which is also how Transpile
+// finds the code to translate:
+// - a linear sweep decodes every word from address 0 in turn;
+// - recursive descent then follows fall-through and constant jumps from
+//   address 0;
+// - code is then guessed from immediate operands that decode as plausible
+//   code, which catches the return addresses pushed before calls.
+// The code found is split into basic blocks, joined into a control flow graph
+// with the edges the jumps make where their targets are immediate.
+//
+// The relative base is propagated through the graph as a constant where it
+// is one, starting from 0 at the entry point.  A guessed block is assumed to
+// start with the base of the code that pushed its address, since that is
+// where a balanced call returns to.  With it, writes and reads through the
+// relative base resolve to addresses where the base is known.  Addresses
+// nothing decodes as code are data, and loops are the natural loops of the
+// graph, nested by depth, which is where a program spends its time.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <iostream>
+
+class Analysis
+{
+public:
+	// what is known about an address
+	enum Flags : uint8_t
+	{
+		Code = 1,		// part of an instruction found by descent
+		Start = 2,		// first word of such an instruction
+		Guessed = 4,	// found only from a guessed entry point
+		Swept = 8,		// first word of an instruction found by the linear sweep
+		Written = 16,	// written by an instruction, at an address known statically
+		Read = 32,		// read as data by an instruction, at an address known statically
+	};
+
+	// how a block ends
+	enum class Exit : uint8_t
+	{
+		Fall,		// runs into the next block
+		Jump,		// jumps on a constant condition
+		Branch,		// jumps or falls through
+		Computed,	// jumps to an address read from memory (and may fall through)
+		Halt,
+		Fault,		// runs into something that does not decode
+	};
+
+	struct Block
+	{
+		int64_t start;
+		int64_t end;		// address after its last instruction
+		Exit exit;
+		bool guessed;		// reached only from a guessed entry point
+		bool baseKnown;		// the relative base on entry is a constant
+		int64_t base;
+		int depth;			// number of loops it is part of
+		std::vector<size_t> successors;
+		std::vector<size_t> predecessors;
+	};
+
+	// a natural loop: its header, and every block in it including the header
+	struct Loop
+	{
+		size_t header;
+		std::vector<size_t> blocks;
+	};
+
+	// a run of addresses that are not code
+	struct Region
+	{
+		int64_t start;
+		int64_t end;
+	};
+
+	static constexpr size_t NoBlock = SIZE_MAX;
+
+	explicit Analysis(std::vector<int64_t> image);
+
+	// analyse a program in any memory backend
+	template<typename Memory>
+	static Analysis Of(const Memory& memory)
+	{
+		return Analysis(std::vector<int64_t>(memory.data(), memory.data() + memory.size()));
+	}
+
+	uint8_t At(int64_t address) const
+	{
+		return address >= 0 && uint64_t(address) < flags.size() ? flags[size_t(address)] : 0;
+	}
+
+	const std::vector<Block>& Blocks() const
+	{
+		return blocks;
+	}
+
+	// the block containing an address, or NoBlock
+	size_t BlockAt(int64_t address) const;
+
+	// loops, innermost first
+	const std::vector<Loop>& Loops() const
+	{
+		return loops;
+	}
+
+	std::vector<Region> DataRegions() const;
+
+	// instructions that write through a relative base that is not known
+	const std::vector<int64_t>& UnresolvedWrites() const
+	{
+		return unresolved;
+	}
+
+	// some instruction writes over code found by descent
+	bool WritesCode() const;
+
+	// relative base in effect at an instruction, if it is known
+	bool BaseAt(int64_t address, int64_t& base) const;
+
+	// write a listing of the blocks, their instructions and the loops
+	void Write(std::ostream& out) const;
+
+private:
+	std::vector<int64_t> image;
+	std::vector<uint8_t> flags;
+	std::vector<Block> blocks;
+	std::vector<Loop> loops;
+	std::vector<int64_t> unresolved;
+
+	// entry points guessed from immediate operands
+	std::vector<int64_t> guesses;
+
+	bool Valid(int64_t address) const;
+	bool Walk(int64_t address, bool guess, std::vector<int64_t>& visited, std::vector<int64_t>& targets, std::vector<int64_t>& operands) const;
+	void Sweep();
+	void Descend();
+	void Split();
+	void Propagate();
+	void Resolve();
+	void FindLoops();
+};
@@ -0,0 +1,584 @@
+#pragma once
+
+// Lockstep Intcode interpreter for running many copies of a program at once
+//
+// Each lane is an independent computer, but memory is laid out structure of
+// arrays: the words at one address in every lane sit next to each other, so
+// an instruction that every lane runs from the same address touches one
+// contiguous row per operand.  Lanes that share a program counter and hold
+// the same instruction there run it together, through AVX2 where available
+// and plain loops otherwise.  Lanes whose instruction differs (such as the
+// first instruction of a noun/verb sweep) are stepped one at a time.
+//
+// Lanes that branch apart are split into groups by program counter, and the
+// group furthest behind runs first so that lanes meet up again where their
+// paths rejoin.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "Intcode.h"
+
+// vectorise lane groups with AVX2 where the compiler targets it
+#ifndef INTCODE_AVX2
+#if defined(__AVX2__)
+#define INTCODE_AVX2 1
+#else
+#define INTCODE_AVX2 0
+#endif
+#endif
+
+#if INTCODE_AVX2
+#include <immintrin.h>
+#endif
+
+template<typename Word>
+class Batch
+{
+public:
+	// lanes are padded to a multiple of this for the vector code
+	static constexpr size_t LaneAlign = 32 / sizeof(Word);
+
+	explicit Batch(size_t lanes)
+		: lanes(lanes)
+		, stride((lanes + LaneAlign - 1) / LaneAlign * LaneAlign)
+		, input(lanes)
+		, output(lanes)
+		, states(lanes, State::Run)
+		, pc(stride, 0)
+		, base(stride, 0)
+		, mask(stride, 0)
+		, row1(stride, 0)
+		, row2(stride, 0)
+	{
+	}
+
+	size_t Lanes() const
+	{
+		return lanes;
+	}
+
+	// load a program into every lane and reset the execution state
+	void Load(const std::vector<Word>& program)
+	{
+		words = program.size();
+		memory.resize(words * stride);
+		for (size_t address = 0; address < words; ++address)
+			std::fill_n(memory.begin() + address * stride, stride, program[address]);
+		std::fill(pc.begin(), pc.end(), Word(0));
+		std::fill(base.begin(), base.end(), Word(0));
+		std::fill(states.begin(), states.end(), State::Run);
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			input[lane].clear();
+			output[lane].clear();
+		}
+		grouped = false;
+	}
+
+	// a word of one lane's memory
+	Word& At(size_t lane, Word address)
+	{
+		return memory[size_t(address) * stride + lane];
+	}
+
+	// queue an input value for a lane
+	void Feed(size_t lane, Word value)
+	{
+		input[lane].push_back(value);
+		if (states[lane] == State::Wait)
+			states[lane] = State::Run;
+	}
+
+	// output values from a lane
+	Channel<Word>& Output(size_t lane)
+	{
+		return output[lane];
+	}
+
+	// state of a lane: running, halted, failed, or waiting for input
+	State LaneState(size_t lane) const
+	{
+		return states[lane];
+	}
+
+	// run every lane until it halts, fails, or needs input
+	void Run()
+	{
+		grouped = false;
+		for (;;)
+		{
+			if (!grouped && !Group())
+				return;
+
+			if (Uniform())
+			{
+				RunGroup();
+				++vectorSteps;
+			}
+			else
+			{
+				// the lanes hold different instructions here, so step each alone
+				Ungroup();
+				for (size_t lane = 0; lane < lanes; ++lane)
+				{
+					if (mask[lane])
+						StepLane(lane);
+				}
+				++scalarSteps;
+			}
+		}
+	}
+
+	// number of instructions run across a lane group, and run lane by lane
+	uint64_t VectorSteps() const
+	{
+		return vectorSteps;
+	}
+	uint64_t ScalarSteps() const
+	{
+		return scalarSteps;
+	}
+
+private:
+	// gather the running lanes at the lowest program counter into the group
+	// mask, returning false if no lane is running
+	bool Group()
+	{
+		Word lowest = std::numeric_limits<Word>::max();
+		bool running = false;
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (states[lane] == State::Wait && !input[lane].empty())
+				states[lane] = State::Run;
+			if (states[lane] == State::Run && (!running || pc[lane] < lowest))
+			{
+				lowest = pc[lane];
+				running = true;
+			}
+		}
+		if (!running)
+			return false;
+
+		leader = SIZE_MAX;
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			const bool member = states[lane] == State::Run && pc[lane] == lowest;
+			mask[lane] = member ? Word(-1) : Word(0);
+			if (member && leader == SIZE_MAX)
+				leader = lane;
+		}
+		ip = lowest;
+		grouped = true;
+		return true;
+	}
+
+	// write the group's program counter back to its lanes before they part
+	void Ungroup()
+	{
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (mask[lane])
+				pc[lane] = ip;
+		}
+		grouped = false;
+	}
+
+	// check that every lane in the group holds the same instruction, with
+	// the same relative base if the instruction uses it
+	bool Uniform()
+	{
+		if (size_t(ip) >= words)
+			return false;
+		const Instruction<Word> i = Decode(memory[size_t(ip) * stride + leader]);
+		const int length = InstructionLength(i.opcode);
+		if (size_t(ip) + length > words)
+			return false;
+		for (int offset = 0; offset < length; ++offset)
+		{
+			const Word* row = &memory[(size_t(ip) + offset) * stride];
+			if (!AllEqual(row, row[leader], mask.data(), stride))
+				return false;
+		}
+		if (i.mode1 == Mode::Relative || i.mode2 == Mode::Relative || i.mode3 == Mode::Relative)
+			return AllEqual(base.data(), base[leader], mask.data(), stride);
+		return true;
+	}
+
+	// row of memory holding an operand, or a row filled with an immediate
+	const Word* Operand(Mode mode, Word value, std::vector<Word>& row)
+	{
+		if (mode == Mode::Immediate)
+		{
+			std::fill(row.begin(), row.end(), value);
+			return row.data();
+		}
+		return Destination(mode, value);
+	}
+
+	// row of memory at an operand's address, or nullptr if it is out of range
+	Word* Destination(Mode mode, Word value)
+	{
+		if (mode == Mode::Relative)
+			value += base[leader];
+		if (size_t(value) >= words)
+			return nullptr;
+		return &memory[size_t(value) * stride];
+	}
+
+	// run the instruction at ip across the group
+	void RunGroup()
+	{
+		const Word* row = &memory[size_t(ip) * stride + leader];
+		const Instruction<Word> i = Decode(row[0]);
+		const Word param1 = InstructionLength(i.opcode) > 1 ? row[stride] : 0;
+		const Word param2 = InstructionLength(i.opcode) > 2 ? row[2 * stride] : 0;
+		const Word param3 = InstructionLength(i.opcode) > 3 ? row[3 * stride] : 0;
+
+		switch (i.opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			{
+				const Word* a = Operand(i.mode1, param1, row1);
+				const Word* b = Operand(i.mode2, param2, row2);
+				Word* dst = Destination(i.mode3 == Mode::Immediate ? Mode::Position : i.mode3, param3);
+				if (!a || !b || !dst)
+					break;
+				Binary(i.opcode, a, b, dst, mask.data(), stride);
+				ip += 4;
+			}
+			return;
+
+		case Opcode::JumpIfTrue:
+		case Opcode::JumpIfFalse:
+			{
+				const Word* condition = Operand(i.mode1, param1, row1);
+				const Word* target = Operand(i.mode2, param2, row2);
+				if (!condition || !target)
+					break;
+				Branch(i.opcode == Opcode::JumpIfTrue, condition, target, ip + 3, pc.data(), mask.data(), stride);
+				grouped = false;
+			}
+			return;
+
+		case Opcode::RelativeBaseOffset:
+			{
+				const Word* offset = Operand(i.mode1, param1, row1);
+				if (!offset)
+					break;
+				Accumulate(base.data(), offset, mask.data(), stride);
+				ip += 2;
+			}
+			return;
+
+		case Opcode::Halt:
+			Ungroup();
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (mask[lane])
+					states[lane] = State::Halt;
+			}
+			return;
+
+		default:
+			// input and output go through each lane's own queues
+			Ungroup();
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				if (mask[lane])
+					StepLane(lane);
+			}
+			return;
+		}
+
+		// an operand was out of range
+		Ungroup();
+		for (size_t lane = 0; lane < lanes; ++lane)
+		{
+			if (mask[lane])
+				states[lane] = State::Error;
+		}
+	}
+
+	// run one instruction in a single lane
+	void StepLane(size_t lane)
+	{
+		Word& ip = pc[lane];
+		if (size_t(ip) >= words)
+		{
+			states[lane] = State::Error;
+			return;
+		}
+		const Instruction<Word> i = Decode(memory[size_t(ip) * stride + lane]);
+		const int length = InstructionLength(i.opcode);
+		if (size_t(ip) + length > words)
+		{
+			states[lane] = State::Error;
+			return;
+		}
+		Word params[3] = {};
+		for (int p = 1; p < length; ++p)
+			params[p - 1] = memory[(size_t(ip) + p) * stride + lane];
+
+		// address of a parameter, or -1 if it is out of range
+		auto address = [&](Mode mode, Word value) -> Word
+		{
+			if (mode == Mode::Relative)
+				value += base[lane];
+			return size_t(value) < words ? value : Word(-1);
+		};
+		Word a = 0, b = 0;
+		const Mode modes[2] = { i.mode1, i.mode2 };
+		Word* reads[2] = { &a, &b };
+		for (int p = 0; p < 2 && p + 1 < length; ++p)
+		{
+			if (i.opcode == Opcode::Input)
+				break;
+			if (modes[p] == Mode::Immediate)
+			{
+				*reads[p] = params[p];
+				continue;
+			}
+			const Word at = address(modes[p], params[p]);
+			if (at < 0)
+			{
+				states[lane] = State::Error;
+				return;
+			}
+			*reads[p] = memory[size_t(at) * stride + lane];
+		}
+
+		switch (i.opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+		case Opcode::Input:
+			{
+				Word value;
+				Word at;
+				if (i.opcode == Opcode::Input)
+				{
+					if (input[lane].empty())
+					{
+						states[lane] = State::Wait;
+						return;
+					}
+					at = address(i.mode1 == Mode::Immediate ? Mode::Position : i.mode1, params[0]);
+					if (at < 0)
+						break;
+					value = input[lane].Pop();
+				}
+				else
+				{
+					at = address(i.mode3 == Mode::Immediate ? Mode::Position : i.mode3, params[2]);
+					if (at < 0)
+						break;
+					value = Evaluate(i.opcode, a, b);
+				}
+				memory[size_t(at) * stride + lane] = value;
+				ip += length;
+			}
+			return;
+
+		case Opcode::Output:
+			output[lane].push_back(a);
+			ip += 2;
+			return;
+
+		case Opcode::JumpIfTrue:
+			ip = a != 0 ? b : ip + 3;
+			return;
+
+		case Opcode::JumpIfFalse:
+			ip = a == 0 ? b : ip + 3;
+			return;
+
+		case Opcode::RelativeBaseOffset:
+			base[lane] += a;
+			ip += 2;
+			return;
+
+		case Opcode::Halt:
+			states[lane] = State::Halt;
+			return;
+
+		default:
+			break;
+		}
+		states[lane] = State::Error;
+	}
+
+	// vector kernels over rows of count words, where mask lanes are all ones
+	// for the lanes in the group and zero for the rest
+
+	// check the masked lanes of a row all hold a value
+	static bool AllEqual(const Word* row, Word value, const Word* mask, size_t count)
+	{
+		Word differ = 0;
+		for (size_t lane = 0; lane < count; ++lane)
+			differ |= (row[lane] ^ value) & mask[lane];
+		return differ == 0;
+	}
+
+	// dst = a op b in the masked lanes
+	static void Binary(Opcode opcode, const Word* a, const Word* b, Word* dst, const Word* mask, size_t count)
+	{
+		switch (opcode)
+		{
+		case Opcode::Add:
+			for (size_t lane = 0; lane < count; ++lane)
+				dst[lane] = Blend(dst[lane], a[lane] + b[lane], mask[lane]);
+			break;
+		case Opcode::Multiply:
+			for (size_t lane = 0; lane < count; ++lane)
+				dst[lane] = Blend(dst[lane], a[lane] * b[lane], mask[lane]);
+			break;
+		case Opcode::LessThan:
+			for (size_t lane = 0; lane < count; ++lane)
+				dst[lane] = Blend(dst[lane], Word(a[lane] < b[lane]), mask[lane]);
+			break;
+		default:
+			for (size_t lane = 0; lane < count; ++lane)
+				dst[lane] = Blend(dst[lane], Word(a[lane] == b[lane]), mask[lane]);
+			break;
+		}
+	}
+
+	// pc = target where the condition holds, otherwise next, in the masked lanes
+	static void Branch(bool ifTrue, const Word* condition, const Word* target, Word next, Word* pc, const Word* mask, size_t count)
+	{
+		for (size_t lane = 0; lane < count; ++lane)
+			pc[lane] = Blend(pc[lane], (condition[lane] != 0) == ifTrue ? target[lane] : next, mask[lane]);
+	}
+
+	// base += offset in the masked lanes
+	static void Accumulate(Word* base, const Word* offset, const Word* mask, size_t count)
+	{
+		for (size_t lane = 0; lane < count; ++lane)
+			base[lane] += offset[lane] & mask[lane];
+	}
+
+	static Word Blend(Word old, Word value, Word mask)
+	{
+		return (value & mask) | (old & ~mask);
+	}
+
+	size_t lanes;
+	size_t stride;		// lanes rounded up to a multiple of LaneAlign
+
+	// memory of every lane, one row of stride words per address
+	std::vector<Word> memory;
+	size_t words = 0;
+
+	std::vector<Channel<Word>> input;
+	std::vector<Channel<Word>> output;
+	std::vector<State> states;
+
+	// per-lane program counter and relative base
+	std::vector<Word> pc;
+	std::vector<Word> base;
+
+	// lanes in the current group, and its shared program counter
+	std::vector<Word> mask;
+	bool grouped = false;
+	Word ip = 0;
+	size_t leader = 0;
+
+	// operand rows for immediates
+	std::vector<Word> row1;
+	std::vector<Word> row2;
+
+	uint64_t vectorSteps = 0;
+	uint64_t scalarSteps = 0;
+};
+
+#if INTCODE_AVX2
+// AVX2 kernels for 32-bit lanes, eight lanes at a time
+
+template<>
+inline bool Batch<int>::AllEqual(const int* row, int value, const int* mask, size_t count)
+{
+	const __m256i broadcast = _mm256_set1_epi32(value);
+	__m256i differ = _mm256_setzero_si256();
+	for (size_t lane = 0; lane < count; lane += 8)
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i*)(row + lane));
+		const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + lane));
+		differ = _mm256_or_si256(differ, _mm256_and_si256(_mm256_xor_si256(x, broadcast), m));
+	}
+	return _mm256_testz_si256(differ, differ) != 0;
+}
+
+template<>
+inline void Batch<int>::Binary(Opcode opcode, const int* a, const int* b, int* dst, const int* mask, size_t count)
+{
+	// apply an operation to each group of eight lanes
+	auto apply = [&](auto op)
+	{
+		for (size_t lane = 0; lane < count; lane += 8)
+		{
+			const __m256i x = _mm256_loadu_si256((const __m256i*)(a + lane));
+			const __m256i y = _mm256_loadu_si256((const __m256i*)(b + lane));
+			const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + lane));
+			const __m256i old = _mm256_loadu_si256((const __m256i*)(dst + lane));
+			_mm256_storeu_si256((__m256i*)(dst + lane), _mm256_blendv_epi8(old, op(x, y), m));
+		}
+	};
+
+	switch (opcode)
+	{
+	case Opcode::Add:
+		apply([](__m256i x, __m256i y) { return _mm256_add_epi32(x, y); });
+		break;
+	case Opcode::Multiply:
+		apply([](__m256i x, __m256i y) { return _mm256_mullo_epi32(x, y); });
+		break;
+	case Opcode::LessThan:
+		apply([](__m256i x, __m256i y) { return _mm256_srli_epi32(_mm256_cmpgt_epi32(y, x), 31); });
+		break;
+	default:
+		apply([](__m256i x, __m256i y) { return _mm256_srli_epi32(_mm256_cmpeq_epi32(x, y), 31); });
+		break;
+	}
+}
+
+template<>
+inline void Batch<int>::Branch(bool ifTrue, const int* condition, const int* target, int next, int* pc, const int* mask, size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i fallthrough = _mm256_set1_epi32(next);
+	const __m256i invert = ifTrue ? _mm256_set1_epi32(-1) : zero;
+	for (size_t lane = 0; lane < count; lane += 8)
+	{
+		const __m256i c = _mm256_loadu_si256((const __m256i*)(condition + lane));
+		const __m256i t = _mm256_loadu_si256((const __m256i*)(target + lane));
+		const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + lane));
+		const __m256i old = _mm256_loadu_si256((const __m256i*)(pc + lane));
+		const __m256i taken = _mm256_xor_si256(_mm256_cmpeq_epi32(c, zero), invert);
+		const __m256i value = _mm256_blendv_epi8(fallthrough, t, taken);
+		_mm256_storeu_si256((__m256i*)(pc + lane), _mm256_blendv_epi8(old, value, m));
+	}
+}
+
+template<>
+inline void Batch<int>::Accumulate(int* base, const int* offset, const int* mask, size_t count)
+{
+	for (size_t lane = 0; lane < count; lane += 8)
+	{
+		const __m256i b = _mm256_loadu_si256((const __m256i*)(base + lane));
+		const __m256i o = _mm256_loadu_si256((const __m256i*)(offset + lane));
+		const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + lane));
+		_mm256_storeu_si256((__m256i*)(base + lane), _mm256_add_epi32(b, _mm256_and_si256(o, m)));
+	}
+}
+#endif
+
+extern template class Batch<int>;
@@ -0,0 +1,236 @@
+#pragma once
+
+// Intcode input and output queue
+//
+// A ring buffer with a power-of-two capacity, so the read and write positions
+// wrap with a mask and taking a value from the front is O(1).  The capacity
+// doubles when a push finds the buffer full, so a host that never drains a
+// channel still sees every value.  The element access names follow the
+// standard containers so a channel can stand in for the std::vector the
+// queues used to be.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+
+template<typename Word>
+class Channel
+{
+public:
+	using value_type = Word;
+
+	// capacity of a channel's first allocation
+	static constexpr size_t InitialCapacity = 64;
+
+	Channel() = default;
+
+	Channel(const Channel& other)
+	{
+		*this = other;
+	}
+
+	Channel(Channel&& other) noexcept
+	{
+		Swap(other);
+	}
+
+	Channel& operator=(const Channel& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			Reserve(other.size());
+			for (size_t i = 0; i < other.size(); ++i)
+				buffer[tail++] = other[i];
+		}
+		return *this;
+	}
+
+	Channel& operator=(Channel&& other) noexcept
+	{
+		Swap(other);
+		return *this;
+	}
+
+	// number of values waiting
+	size_t size() const
+	{
+		return size_t(tail - head);
+	}
+
+	bool empty() const
+	{
+		return head == tail;
+	}
+
+	// number of values held before the buffer has to grow
+	size_t capacity() const
+	{
+		return mask ? mask + 1 : 0;
+	}
+
+	// drop all waiting values, keeping the buffer
+	void clear()
+	{
+		head = tail = 0;
+	}
+
+	// value at a position counted from the front
+	Word& operator[](size_t index)
+	{
+		return buffer[(head + index) & mask];
+	}
+	const Word& operator[](size_t index) const
+	{
+		return buffer[(head + index) & mask];
+	}
+
+	Word& front()
+	{
+		return buffer[head & mask];
+	}
+	const Word& front() const
+	{
+		return buffer[head & mask];
+	}
+
+	Word& back()
+	{
+		return buffer[(tail - 1) & mask];
+	}
+	const Word& back() const
+	{
+		return buffer[(tail - 1) & mask];
+	}
+
+	// add a value to the back
+	void push_back(Word value)
+	{
+		if (size() == capacity())
+			Reserve(size() + 1);
+		buffer[tail++ & mask] = value;
+	}
+
+	// remove the value at the front
+	void pop_front()
+	{
+		++head;
+	}
+
+	// remove the value at the back
+	void pop_back()
+	{
+		--tail;
+	}
+
+	// take the value at the front
+	Word Pop()
+	{
+		return buffer[head++ & mask];
+	}
+
+	// add values to the back
+	void Push(const Word* values, size_t count)
+	{
+		Reserve(size() + count);
+		while (count)
+		{
+			// copy up to the end of the buffer, then wrap
+			const size_t start = tail & mask;
+			const size_t run = std::min(count, capacity() - start);
+			std::copy(values, values + run, buffer.get() + start);
+			tail += run;
+			values += run;
+			count -= run;
+		}
+	}
+
+	// add a range of values of any type to the back
+	template<typename Iterator>
+	void Push(Iterator first, Iterator last)
+	{
+		Reserve(size() + size_t(std::distance(first, last)));
+		for (; first != last; ++first)
+			buffer[tail++ & mask] = Word(*first);
+	}
+
+	// take up to count values from the front, returning how many were taken
+	size_t Drain(Word* values, size_t count)
+	{
+		count = std::min(count, size());
+		for (size_t left = count; left; )
+		{
+			const size_t start = head & mask;
+			const size_t run = std::min(left, capacity() - start);
+			std::copy(buffer.get() + start, buffer.get() + start + run, values);
+			head += run;
+			values += run;
+			left -= run;
+		}
+		return count;
+	}
+
+	// take all waiting values, appending them to a vector
+	void Drain(std::vector<Word>& values)
+	{
+		const size_t count = size();
+		values.resize(values.size() + count);
+		Drain(values.data() + values.size() - count, count);
+	}
+
+	// move all waiting values to the back of another channel
+	void Drain(Channel& other)
+	{
+		other.Reserve(other.size() + size());
+		while (!empty())
+		{
+			const size_t start = head & mask;
+			const size_t run = std::min(size(), capacity() - start);
+			other.Push(buffer.get() + start, run);
+			head += run;
+		}
+	}
+
+	// make room for at least the given number of values
+	void Reserve(size_t count)
+	{
+		if (count <= capacity())
+			return;
+
+		size_t grown = std::max(capacity(), size_t(InitialCapacity));
+		while (grown < count)
+			grown *= 2;
+
+		// unwrap the waiting values into the new buffer
+		std::unique_ptr<Word[]> values(new Word[grown]);
+		const size_t waiting = size();
+		for (size_t i = 0; i < waiting; ++i)
+			values[i] = (*this)[i];
+
+		buffer = std::move(values);
+		mask = grown - 1;
+		head = 0;
+		tail = waiting;
+	}
+
+	void Swap(Channel& other) noexcept
+	{
+		std::swap(buffer, other.buffer);
+		std::swap(mask, other.mask);
+		std::swap(head, other.head);
+		std::swap(tail, other.tail);
+	}
+
+private:
+	std::unique_ptr<Word[]> buffer;
+
+	// capacity - 1, or 0 before the first allocation
+	size_t mask = 0;
+
+	// running read and write positions, masked to index the buffer
+	size_t head = 0;
+	size_t tail = 0;
+};
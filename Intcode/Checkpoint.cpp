@@ -0,0 +1,112 @@
+#include "Intcode.h"
+#include "Varint.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char Magic[8] = { 'I', 'N', 'T', 'C', 'C', 'K', 'P', '\0' };
+	const uint8_t Version = 1;
+
+	using Varint::Put;
+	using Varint::PutSigned;
+	using Varint::Get;
+	using Varint::GetSigned;
+
+	void PutWords(std::ostream& out, const std::vector<int64_t>& words)
+	{
+		Put(out, words.size());
+		for (const int64_t word : words)
+			PutSigned(out, word);
+	}
+
+	bool GetWords(std::istream& in, std::vector<int64_t>& words)
+	{
+		uint64_t count;
+		if (!Get(in, count))
+			return false;
+		words.clear();
+		for (uint64_t n = 0; n < count; ++n)
+		{
+			int64_t word;
+			if (!GetSigned(in, word))
+				return false;
+			words.push_back(word);
+		}
+		return true;
+	}
+}
+
+// the magic and version, then as variable-length integers: the word size,
+// pc and relative base, the image, the pages with their addresses, the input
+// and output queues and the host words, each list preceded by its length
+bool Checkpoint::Save(const std::string& path) const
+{
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary);
+		if (!out)
+			return false;
+
+		out.write(Magic, sizeof(Magic));
+		out.put(char(Version));
+
+		Put(out, uint64_t(wordSize));
+		PutSigned(out, pc);
+		PutSigned(out, relativebase);
+		PutWords(out, image);
+		Put(out, pages.size());
+		for (const Page& page : pages)
+		{
+			PutSigned(out, page.address);
+			PutWords(out, page.words);
+		}
+		PutWords(out, input);
+		PutWords(out, output);
+		PutWords(out, host);
+
+		if (!out.flush())
+			return false;
+	}
+
+	// replace the last checkpoint only once this one is complete
+#ifdef _WIN32
+	std::remove(path.c_str());
+#endif
+	return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool Checkpoint::Load(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	char magic[sizeof(Magic)];
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || in.get() != Version)
+		return false;
+
+	Checkpoint checkpoint;
+	uint64_t size;
+	if (!Get(in, size) || (size != 4 && size != 8))
+		return false;
+	checkpoint.wordSize = int(size);
+	if (!GetSigned(in, checkpoint.pc) || !GetSigned(in, checkpoint.relativebase) || !GetWords(in, checkpoint.image))
+		return false;
+
+	uint64_t count;
+	if (!Get(in, count))
+		return false;
+	for (uint64_t n = 0; n < count; ++n)
+	{
+		Page page;
+		if (!GetSigned(in, page.address) || !GetWords(in, page.words))
+			return false;
+		checkpoint.pages.push_back(std::move(page));
+	}
+
+	if (!GetWords(in, checkpoint.input) || !GetWords(in, checkpoint.output) || !GetWords(in, checkpoint.host))
+		return false;
+
+	*this = std::move(checkpoint);
+	return true;
+}
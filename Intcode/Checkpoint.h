@@ -0,0 +1,153 @@
+#pragma once
+
+// Checkpoints of an Intcode computer's execution state
+//
+// A Checkpoint holds everything needed to carry on a run later: the memory,
+// as the program image and any pages written beyond it, the program counter,
+// the relative base and the values waiting in the input and output queues.
+// Decoded and compiled instructions are left out and rebuilt as the restored
+// computer runs.  Hosts whose own state goes along with the computer's (the
+// ball and paddle in day 13) can keep it in the host words.
+//
+// Checkpoints are saved in a versioned binary form, mostly variable-length
+// integers, to a temporary file that then replaces the old one, so an
+// interrupted save leaves the previous checkpoint intact.
+//
+// A computer given a Checkpointer saves a checkpoint every so many runs, as
+// RunUntil starts, when everything the host has done since the last run is
+// in the queues.  A run that never stops for input or output is saved only
+// before it starts.
+//
+// Included by Intcode.h.
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+class Checkpoint
+{
+public:
+	// words written beyond the program image
+	struct Page
+	{
+		int64_t address;
+		std::vector<int64_t> words;
+	};
+
+	// bytes per word of the computer it was taken from
+	int wordSize = 8;
+
+	int64_t pc = 0;
+	int64_t relativebase = 0;
+	std::vector<int64_t> image;
+	std::vector<Page> pages;
+	std::vector<int64_t> input;
+	std::vector<int64_t> output;
+
+	// state the host keeps alongside the computer
+	std::vector<int64_t> host;
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// take a copy of a memory backend
+	template<typename Word>
+	void SetMemory(const std::vector<Word>& memory)
+	{
+		image.assign(memory.begin(), memory.end());
+		pages.clear();
+	}
+	template<typename Word>
+	void SetMemory(const PagedMemory<Word>& memory)
+	{
+		image.assign(memory.data(), memory.data() + memory.size());
+		pages.clear();
+		memory.VisitPages([this](int64_t address, const Word* words, size_t count)
+		{
+			// untouched words read as zero anyway
+			if (std::all_of(words, words + count, [](Word word) { return word == 0; }))
+				return;
+			pages.push_back({ address, std::vector<int64_t>(words, words + count) });
+		});
+	}
+
+	// replace the contents of a memory backend with the saved ones
+	template<typename Word>
+	void CopyTo(std::vector<Word>& memory) const
+	{
+		memory.assign(image.begin(), image.end());
+		for (const Page& page : pages)
+		{
+			// a plain vector holds no pages, so grow it to cover them
+			if (page.address < 0)
+				continue;
+			const size_t end = size_t(page.address) + page.words.size();
+			if (memory.size() < end)
+				memory.resize(end, Word(0));
+			std::copy(page.words.begin(), page.words.end(), memory.begin() + size_t(page.address));
+		}
+	}
+	template<typename Word>
+	void CopyTo(PagedMemory<Word>& memory) const
+	{
+		memory = PagedMemory<Word>();
+		memory.Grow(image.size());
+		std::copy(image.begin(), image.end(), memory.data());
+		for (const Page& page : pages)
+		{
+			for (size_t i = 0; i < page.words.size(); ++i)
+			{
+				if (page.words[i])
+					memory[page.address + int64_t(i)] = Word(page.words[i]);
+			}
+		}
+	}
+};
+
+// saves a computer's state every so many runs
+class Checkpointer
+{
+public:
+	Checkpointer(const std::string& path, uint64_t every)
+		: path(path), every(every ? every : 1)
+	{
+	}
+
+	// state the host keeps alongside the computer, saved with it
+	std::vector<int64_t> host;
+
+	const std::string& Path() const
+	{
+		return path;
+	}
+
+	// checkpoints saved so far
+	uint64_t Saved() const
+	{
+		return saved;
+	}
+
+	// a run is starting; true if a checkpoint is due
+	bool Due()
+	{
+		return runs++ % every == 0;
+	}
+
+	// save a checkpoint, adding the host state
+	bool Save(Checkpoint& checkpoint)
+	{
+		checkpoint.host = host;
+		if (!checkpoint.Save(path))
+			return false;
+		++saved;
+		return true;
+	}
+
+private:
+	std::string path;
+	uint64_t every;
+	uint64_t runs = 0;
+	uint64_t saved = 0;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+// C++20 coroutine front end for driving Intcode computers
+//
+// Host code is written as a coroutine returning Task that does
+//
+//     co_await machine.Write(value);
+//     std::optional<Word> value = co_await machine.Read();
+//
+// Read runs the computer at full speed until it produces an output (or halts
+// or fails, giving an empty value), with no checks between instructions.  If
+// the computer needs input first, the task is suspended until another task
+// writes to the machine.  Tasks are run by a Scheduler, so several machines
+// and the tasks that feed them can be written as straight-line code.
+
+#include "Intcode.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define INTCODE_COROUTINES 1
+#else
+#define INTCODE_COROUTINES 0
+#endif
+
+#if INTCODE_COROUTINES
+
+#include <coroutine>
+#include <optional>
+#include <deque>
+#include <exception>
+
+// a host coroutine, which does nothing until a scheduler starts it
+class Task
+{
+public:
+	struct promise_type
+	{
+		Task get_return_object()
+		{
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept
+		{
+			return {};
+		}
+		std::suspend_always final_suspend() noexcept
+		{
+			return {};
+		}
+		void return_void()
+		{
+		}
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+	};
+
+	Task(Task&& other) noexcept
+		: handle(other.handle)
+	{
+		other.handle = nullptr;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task()
+	{
+		if (handle)
+			handle.destroy();
+	}
+
+	bool Done() const
+	{
+		return !handle || handle.done();
+	}
+
+private:
+	friend class Scheduler;
+
+	explicit Task(std::coroutine_handle<promise_type> handle)
+		: handle(handle)
+	{
+	}
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+// runs tasks until they finish or are all waiting on input nobody will write
+class Scheduler
+{
+public:
+	// take a task and queue it to start
+	void Spawn(Task task)
+	{
+		ready.push_back(task.handle);
+		tasks.push_back(std::move(task));
+	}
+
+	// queue a suspended coroutine to resume
+	void Wake(std::coroutine_handle<> handle)
+	{
+		ready.push_back(handle);
+	}
+
+	// resume queued coroutines until there are none; returns true if every
+	// task finished
+	bool Run()
+	{
+		while (!ready.empty())
+		{
+			std::coroutine_handle<> handle = ready.front();
+			ready.pop_front();
+			handle.resume();
+		}
+		for (const Task& task : tasks)
+		{
+			if (!task.Done())
+				return false;
+		}
+		return true;
+	}
+
+private:
+	std::deque<std::coroutine_handle<>> ready;
+	std::deque<Task> tasks;
+};
+
+// a computer that tasks read from and write to
+template<typename Word, typename Memory = PagedMemory<Word>>
+class Machine
+{
+public:
+	Machine(Computer<Word, Memory>& computer, Scheduler& scheduler)
+		: computer(computer)
+		, scheduler(scheduler)
+	{
+	}
+
+	// the next output, or an empty value once the computer has halted or failed
+	auto Read()
+	{
+		struct Awaiter
+		{
+			Machine& machine;
+			std::optional<Word> value;
+
+			bool await_ready()
+			{
+				return machine.TryRead(value);
+			}
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				// wait for a write to give the computer its input
+				machine.reader = handle;
+				machine.result = &value;
+			}
+			std::optional<Word> await_resume()
+			{
+				return value;
+			}
+		};
+		return Awaiter{ *this, std::nullopt };
+	}
+
+	// queue an input value, resuming a task that was waiting to read
+	auto Write(Word value)
+	{
+		computer.Feed(value);
+		if (reader && TryRead(*result))
+		{
+			scheduler.Wake(reader);
+			reader = nullptr;
+		}
+		return std::suspend_never();
+	}
+
+	State GetState() const
+	{
+		return state;
+	}
+
+private:
+	// run until there is an output to read, returning false if the computer
+	// needs input first
+	bool TryRead(std::optional<Word>& value)
+	{
+		if (computer.output.empty() && state != State::Halt && state != State::Error)
+		{
+			state = computer.RunUntil(1);
+			if (state == State::Wait)
+				return false;
+		}
+		if (computer.output.empty())
+			value.reset();
+		else
+			value = computer.output.Pop();
+		return true;
+	}
+
+	Computer<Word, Memory>& computer;
+	Scheduler& scheduler;
+	State state = State::Run;
+
+	// task suspended in Read, and where its value goes
+	std::coroutine_handle<> reader;
+	std::optional<Word>* result = nullptr;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "Image.h"
+#include "Analysis.h"
+
+#include <fstream>
+#include <climits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char Magic[8] = { 'I', 'N', 'T', 'C', 'I', 'M', 'G', '\0' };
+	const uint32_t Version = 1;
+	const size_t HeaderSize = 32;
+
+	// write a little-endian value
+	template<typename T>
+	void PutLittle(std::ostream& out, T value)
+	{
+		for (size_t b = 0; b < sizeof(T); ++b)
+			out.put(char(uint8_t(uint64_t(value) >> (8 * b))));
+	}
+}
+
+ProgramImage::ProgramImage(const std::string& path)
+{
+#ifdef _WIN32
+	handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		handle = nullptr;
+		return;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(handle, &size) || size.QuadPart < LONGLONG(HeaderSize))
+		return;
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		return;
+	data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	length = size_t(size.QuadPart);
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size >= off_t(HeaderSize))
+	{
+		void* memory = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (memory != MAP_FAILED)
+		{
+			data = static_cast<const uint8_t*>(memory);
+			length = size_t(status.st_size);
+		}
+	}
+	// the mapping keeps the file open
+	close(file);
+#endif
+	if (!data)
+		return;
+
+	// check the header before trusting any of it
+	const uint32_t version = Little<uint32_t>(data + 8);
+	const uint32_t size = Little<uint32_t>(data + 12);
+	const uint64_t total = Little<uint64_t>(data + 16);
+	const uint64_t section = Little<uint64_t>(data + 24);
+	if (std::memcmp(data, Magic, sizeof(Magic)) != 0 || version != Version || (size != 4 && size != 8))
+		return;
+	if (total > (length - HeaderSize) / size)
+		return;
+	if (section && (section < HeaderSize + total * size || section > length || total > (length - section) / 2))
+		return;
+
+	wordSize = int(size);
+	count = size_t(total);
+	words = data + HeaderSize;
+	decoded = section ? data + section : nullptr;
+}
+
+ProgramImage::~ProgramImage()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (handle)
+		CloseHandle(handle);
+#else
+	if (data)
+		munmap(const_cast<uint8_t*>(data), length);
+#endif
+}
+
+bool WriteImage(const std::string& path, const std::vector<int64_t>& program, int wordSize, bool predecode)
+{
+	if (wordSize != 4 && wordSize != 8)
+		return false;
+	if (wordSize == 4)
+	{
+		for (const int64_t word : program)
+		{
+			if (word < INT32_MIN || word > INT32_MAX)
+				return false;
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+
+	const uint64_t section = predecode ? HeaderSize + program.size() * wordSize : 0;
+	out.write(Magic, sizeof(Magic));
+	PutLittle<uint32_t>(out, Version);
+	PutLittle<uint32_t>(out, uint32_t(wordSize));
+	PutLittle<uint64_t>(out, program.size());
+	PutLittle<uint64_t>(out, section);
+
+	for (const int64_t word : program)
+	{
+		if (wordSize == 4)
+			PutLittle<uint32_t>(out, uint32_t(int32_t(word)));
+		else
+			PutLittle<uint64_t>(out, uint64_t(word));
+	}
+
+	if (predecode)
+	{
+		// only the instructions analysis is sure of, not the guessed ones
+		const Analysis analysis(program);
+		for (size_t address = 0; address < program.size(); ++address)
+		{
+			const uint8_t mark = analysis.At(int64_t(address));
+			if (!(mark & Analysis::Start) || (mark & Analysis::Guessed))
+			{
+				out.put(0);
+				out.put(0);
+				continue;
+			}
+			const Instruction<int64_t> i = Decode(program[address]);
+			out.put(char(i.opcode));
+			out.put(char(int(i.mode1) | int(i.mode2) << 2 | int(i.mode3) << 4));
+		}
+	}
+
+	return bool(out);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+// Binary Intcode program images
+//
+// ReadInput parses a program from text, which costs more than running many
+// of the programs do.  An image holds the same program ready to load:
+//
+//     0   magic "INTCIMG\0"
+//     8   version (32 bits)
+//     12  bytes per word, 4 or 8 (32 bits)
+//     16  number of words (64 bits)
+//     24  offset of the pre-decoded section, or 0 if there is none (64 bits)
+//     32  the words
+//
+// with everything little-endian.  The optional pre-decoded section has two
+// bytes for each word: the opcode of the instruction starting there, or 0 if
+// static analysis found none, and its three parameter modes, two bits each.
+// Computer::Predecode fills its decode cache from it without decoding the
+// words again, so the section has to come from the same image as the words.
+//
+// ProgramImage maps an image file instead of reading it, so loading one is a
+// copy of its words into the memory backend (a single memcpy where the word
+// sizes match) with no parsing at all.  WriteImage and the MakeImage tool
+// convert a text program into an image.
+
+#include "Intcode.h"
+
+#include <cstring>
+#include <string>
+
+class ProgramImage
+{
+public:
+	// map an image file; check Ready before using it
+	explicit ProgramImage(const std::string& path);
+	~ProgramImage();
+
+	ProgramImage(const ProgramImage&) = delete;
+	ProgramImage& operator=(const ProgramImage&) = delete;
+
+	// the file was mapped and is an image
+	bool Ready() const
+	{
+		return words != nullptr;
+	}
+
+	// number of words
+	size_t size() const
+	{
+		return count;
+	}
+
+	int WordSize() const
+	{
+		return wordSize;
+	}
+
+	int64_t operator[](size_t index) const
+	{
+		if (wordSize == 4)
+			return int32_t(Little<uint32_t>(words + index * 4));
+		return int64_t(Little<uint64_t>(words + index * 8));
+	}
+
+	// the pre-decoded section, or nullptr if the image has none
+	const uint8_t* Decoded() const
+	{
+		return decoded;
+	}
+
+	// replace the contents of a memory backend with the words
+	template<typename Memory>
+	void CopyTo(Memory& memory) const
+	{
+		using Word = typename Memory::value_type;
+		Clear(memory);
+		if (count == 0)
+			return;
+		Resize(memory, count);
+		Word* out = memory.data();
+		if (sizeof(Word) == size_t(wordSize) && LittleEndian())
+		{
+			std::memcpy(out, words, count * sizeof(Word));
+			return;
+		}
+		for (size_t index = 0; index < count; ++index)
+			out[index] = Word((*this)[index]);
+	}
+
+	// read a little-endian value
+	template<typename T>
+	static T Little(const uint8_t* bytes)
+	{
+		T value = 0;
+		for (size_t b = 0; b < sizeof(T); ++b)
+			value |= T(bytes[b]) << (8 * b);
+		return value;
+	}
+
+private:
+	static bool LittleEndian()
+	{
+		const uint16_t probe = 1;
+		return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+	}
+
+	template<typename Word>
+	static void Clear(std::vector<Word>& memory)
+	{
+		memory.clear();
+	}
+	template<typename Word>
+	static void Clear(PagedMemory<Word>& memory)
+	{
+		memory = PagedMemory<Word>();
+	}
+
+	template<typename Word>
+	static void Resize(std::vector<Word>& memory, size_t size)
+	{
+		memory.resize(size);
+	}
+	template<typename Word>
+	static void Resize(PagedMemory<Word>& memory, size_t size)
+	{
+		memory.Grow(size);
+	}
+
+	// the mapping
+	const uint8_t* data = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* handle = nullptr;
+	void* mapping = nullptr;
+#endif
+
+	// what it holds
+	const uint8_t* words = nullptr;
+	const uint8_t* decoded = nullptr;
+	size_t count = 0;
+	int wordSize = 0;
+};
+
+// write a program as an image with words of the given size, adding a
+// pre-decoded section if asked; false if a word does not fit or the file
+// cannot be written
+bool WriteImage(const std::string& path, const std::vector<int64_t>& program, int wordSize, bool predecode);
+
+// load an image file into a memory backend; false if it is not an image
+template<typename Memory>
+bool ReadImage(Memory& memory, const std::string& path)
+{
+	const ProgramImage image(path);
+	if (!image.Ready())
+		return false;
+	image.CopyTo(memory);
+	return true;
+}
@@ -0,0 +1,89 @@
+#include "Intcode.h"
+#include "Varint.h"
+
+#include <fstream>
+#include <cstring>
+
+namespace
+{
+	const char Magic[8] = { 'I', 'N', 'T', 'C', 'I', 'N', 'P', '\0' };
+	const uint8_t Version = 1;
+
+	using Varint::Put;
+	using Varint::PutSigned;
+	using Varint::Get;
+	using Varint::GetSigned;
+}
+
+// the magic and version, then as variable-length integers: the patches,
+// the inputs with the instruction counts between them, the instructions
+// run, and the output count and checksum
+bool InputLog::Save(const std::string& path) const
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+
+	out.write(Magic, sizeof(Magic));
+	out.put(char(Version));
+
+	Put(out, patches.size());
+	for (const Patch& patch : patches)
+	{
+		PutSigned(out, patch.address);
+		PutSigned(out, patch.value);
+	}
+
+	Put(out, inputs.size());
+	uint64_t previous = 0;
+	for (const Entry& entry : inputs)
+	{
+		Put(out, entry.instruction - previous);
+		PutSigned(out, entry.value);
+		previous = entry.instruction;
+	}
+
+	Put(out, instructions);
+	Put(out, outputs);
+	Put(out, checksum);
+	return bool(out);
+}
+
+bool InputLog::Load(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	char magic[sizeof(Magic)];
+	if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0 || in.get() != Version)
+		return false;
+
+	InputLog log;
+	uint64_t count;
+	if (!Get(in, count))
+		return false;
+	for (uint64_t n = 0; n < count; ++n)
+	{
+		Patch patch;
+		if (!GetSigned(in, patch.address) || !GetSigned(in, patch.value))
+			return false;
+		log.patches.push_back(patch);
+	}
+
+	if (!Get(in, count))
+		return false;
+	uint64_t instruction = 0;
+	for (uint64_t n = 0; n < count; ++n)
+	{
+		uint64_t delta;
+		int64_t value;
+		if (!Get(in, delta) || !GetSigned(in, value))
+			return false;
+		instruction += delta;
+		log.inputs.push_back({ instruction, value });
+	}
+
+	if (!Get(in, log.instructions) || !Get(in, log.outputs) || !Get(in, log.checksum))
+		return false;
+
+	*this = std::move(log);
+	return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Record and replay of the input an Intcode program consumes
+//
+// A computer given an InputLog to record into notes every input value it
+// consumes, along with the number of instructions it had run when it did,
+// plus a count and checksum of its outputs.  The log is saved in a compact
+// binary form, so a run whose input the host computes on the fly (the
+// paddle in day 13, the robot's moves in day 15) can be replayed later with
+// no host logic at all: Replay queues every value up front and runs the
+// computer to the end at full speed, and Matches checks that the replay did
+// what the recorded run did.
+//
+// Recording runs the computer on the same one-at-a-time interpreter as
+// tracing, since counting instructions needs it; replaying does not.
+//
+// Included by Intcode.h.
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class InputLog
+{
+public:
+	// an input value and the number of instructions run before it was read
+	struct Entry
+	{
+		uint64_t instruction;
+		int64_t value;
+	};
+
+	// a word the host wrote before the program started
+	struct Patch
+	{
+		int64_t address;
+		int64_t value;
+	};
+
+	// note a word the host writes before starting the program, so that a
+	// replay can write it too
+	void Poke(int64_t address, int64_t value)
+	{
+		patches.push_back({ address, value });
+	}
+
+	void Input(uint64_t instruction, int64_t value)
+	{
+		inputs.push_back({ instruction, value });
+	}
+
+	void Output(int64_t value)
+	{
+		// FNV-1a over the words
+		checksum = (checksum ^ uint64_t(value)) * 0x100000001B3ull;
+		++outputs;
+	}
+
+	void Ran(uint64_t count)
+	{
+		instructions += count;
+	}
+
+	const std::vector<Entry>& Inputs() const
+	{
+		return inputs;
+	}
+
+	// instructions run while recording
+	uint64_t Instructions() const
+	{
+		return instructions;
+	}
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// start a computer on the recorded input and run it until it halts,
+	// fails, or runs out of input
+	template<typename Computer>
+	State Replay(Computer& computer) const
+	{
+		for (const Patch& patch : patches)
+			computer.Poke(patch.address, patch.value);
+		for (const Entry& entry : inputs)
+			computer.Feed(entry.value);
+		return computer.Run();
+	}
+
+	// the outputs match the ones recorded
+	template<typename Word>
+	bool Matches(const std::vector<Word>& values) const
+	{
+		InputLog replayed;
+		for (Word value : values)
+			replayed.Output(int64_t(value));
+		return replayed.outputs == outputs && replayed.checksum == checksum;
+	}
+
+private:
+	std::vector<Patch> patches;
+	std::vector<Entry> inputs;
+	uint64_t instructions = 0;
+	uint64_t outputs = 0;
+	uint64_t checksum = 0xCBF29CE484222325ull;
+};
@@ -0,0 +1,67 @@
+#include "Intcode.h"
+#include "Batch.h"
+
+// name of an opcode, or nullptr if it is not valid
+const char* OpcodeName(Opcode opcode)
+{
+	switch (opcode)
+	{
+	case Opcode::Add: return "add";
+	case Opcode::Multiply: return "mul";
+	case Opcode::Input: return "in";
+	case Opcode::Output: return "out";
+	case Opcode::JumpIfTrue: return "jnz";
+	case Opcode::JumpIfFalse: return "jz";
+	case Opcode::LessThan: return "lt";
+	case Opcode::Equals: return "eq";
+	case Opcode::RelativeBaseOffset: return "arb";
+	case Opcode::Halt: return "halt";
+	default: return nullptr;
+	}
+}
+
+// name of a state
+const char* StateName(State state)
+{
+	switch (state)
+	{
+	case State::Run: return "run";
+	case State::Halt: return "halt";
+	case State::Error: return "error";
+	case State::Wait: return "wait";
+	case State::Output: return "output";
+	default: return "unknown";
+	}
+}
+
+// name of a superinstruction
+const char* FusionName(Fusion fusion)
+{
+	switch (fusion)
+	{
+	case Fusion::Set: return "set";
+	case Fusion::Goto: return "goto";
+	case Fusion::TestJumpIfTrue: return "test-jnz";
+	case Fusion::TestJumpIfFalse: return "test-jz";
+	case Fusion::AdjustJumpIfTrue: return "arb-jnz";
+	case Fusion::AdjustJumpIfFalse: return "arb-jz";
+	default: return "none";
+	}
+}
+
+// name of a dispatch strategy
+const char* DispatchName(Dispatch dispatch)
+{
+	switch (dispatch)
+	{
+	case Dispatch::Best: return "best";
+	case Dispatch::Switch: return "switch";
+	case Dispatch::Threaded: return "threaded";
+	case Dispatch::Native: return "native";
+	default: return "unknown";
+	}
+}
+
+template class Computer<int, std::vector<int>>;
+template class Computer<int64_t, PagedMemory<int64_t>>;
+template class Batch<int>;
@@ -0,0 +1,1042 @@
+#pragma once
+
+// Intcode computer shared by the Intcode days
+//
+// Computer is templated on the word type and the memory backend so that the
+// early days can run a 32-bit program out of a plain std::vector<int> while
+// the later days use 64-bit words in paged memory.
+//
+// Instructions in the program image are decoded once, along with their
+// parameter words, and cached by address.  Writes through the computer drop
+// any cached instruction they overlap, so self-modifying programs still work.
+// With INTCODE_FUSION set, common instruction pairs are fused as they are
+// decoded into superinstructions that the interpreters run in one dispatch.
+//
+// Where INTCODE_JIT is set, 64-bit programs in paged memory can run as native
+// code compiled by Jit, falling back to the interpreter one instruction at a
+// time for anything the compiled code hands back.  The day programs stop for
+// input and output and rewrite their own operands too often for that to pay,
+// so a computer only compiles when asked to with Dispatch::Native.
+//
+// A computer given a Trace runs on a slower interpreter that records every
+// instruction in it, so the run leading up to a fault can be read back.  The
+// same interpreter records the input a program consumes into an InputLog, so
+// the run can be replayed later without the host.
+//
+// Snapshot and Restore take a computer's execution state to and from a
+// Checkpoint, which can be saved to disk; given a Checkpointer, a computer
+// saves one every so many runs.
+
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+#include "Memory.h"
+#include "Channel.h"
+#include "Jit.h"
+
+// count where programs spend their time (see Profile.h)
+#ifndef INTCODE_PROFILE
+#define INTCODE_PROFILE 0
+#endif
+
+// fuse common instruction pairs into superinstructions
+// (not while profiling, which counts the instructions one by one)
+#ifndef INTCODE_FUSION
+#define INTCODE_FUSION !INTCODE_PROFILE
+#endif
+
+// use threaded-code dispatch where the compiler supports computed goto
+#ifndef INTCODE_THREADED
+#if defined(__GNUC__)
+#define INTCODE_THREADED 1
+#else
+#define INTCODE_THREADED 0
+#endif
+#endif
+
+enum class Opcode : uint8_t
+{
+	Add = 1,
+	Multiply = 2,
+	Input = 3,
+	Output = 4,
+	JumpIfTrue = 5,
+	JumpIfFalse = 6,
+	LessThan = 7,
+	Equals = 8,
+	RelativeBaseOffset = 9,
+	Halt = 99
+};
+
+// superinstructions fused from common instruction sequences
+// (numbered after the opcodes so the interpreters can switch on both)
+enum class Fusion : uint8_t
+{
+	None = 0,
+	Set = 100,				// add, multiply, less than or equals on two immediates
+	Goto,					// jump on an immediate condition that always jumps
+	TestJumpIfTrue,			// add, multiply, less than or equals, then jump if the result is true
+	TestJumpIfFalse,		// add, multiply, less than or equals, then jump if the result is false
+	AdjustJumpIfTrue,		// relative base offset by an immediate, then jump if true
+	AdjustJumpIfFalse,		// relative base offset by an immediate, then jump if false
+};
+
+constexpr int FusionCount = 6;
+
+// longest run of words covered by one decoded instruction
+constexpr int MaxSpan = 7;
+
+enum class Mode : uint8_t
+{
+	Position = 0,
+	Immediate = 1,
+	Relative = 2,
+};
+
+enum class State
+{
+	Run,
+	Halt,
+	Error,
+	Wait,	// waiting for input
+	Output	// produced the requested number of outputs
+};
+
+// how a computer runs its program
+// (anything not available in the build, or for the memory, runs as Best)
+enum class Dispatch : uint8_t
+{
+	Best,		// the fastest interpreter available
+	Switch,		// switch interpreter
+	Threaded,	// threaded-code interpreter, where the compiler supports it
+	Native,		// compiled code, where INTCODE_JIT is set and the memory allows it
+				// (faster on long computations, slower on the days' programs)
+};
+
+// name of an opcode, or nullptr if it is not valid
+const char* OpcodeName(Opcode opcode);
+
+// name of a state
+const char* StateName(State state);
+
+// name of a superinstruction
+const char* FusionName(Fusion fusion);
+
+// name of a dispatch strategy
+const char* DispatchName(Dispatch dispatch);
+
+#if INTCODE_PROFILE
+#include "Profile.h"
+
+// pass an event to the computer's profile, if it has one
+#define INTCODE_PROFILED(event) do { if (profile) profile->event; } while (false)
+#else
+#define INTCODE_PROFILED(event) do { } while (false)
+#endif
+
+#include "Parse.h"
+
+// pre-decoded instruction
+// (opcode 0 marks an address that has not been decoded)
+template<typename Word>
+struct Instruction
+{
+	Opcode opcode;
+	Mode mode1;
+	Mode mode2;
+	Mode mode3;
+	Mode mode4;		// jump target of a fused test and jump
+	Fusion fusion;	// superinstruction this instruction starts
+	uint8_t span;	// number of words covered, including any fused instruction
+	Word param1;
+	Word param2;
+	Word param3;
+	Word param4;
+#if INTCODE_THREADED
+	void* handler;	// threaded-code handler, or nullptr if not bound
+#endif
+};
+
+// number of words in an instruction, including the opcode
+inline int InstructionLength(Opcode opcode)
+{
+	switch (opcode)
+	{
+	case Opcode::Add:
+	case Opcode::Multiply:
+	case Opcode::LessThan:
+	case Opcode::Equals:
+		return 4;
+	case Opcode::JumpIfTrue:
+	case Opcode::JumpIfFalse:
+		return 3;
+	case Opcode::Input:
+	case Opcode::Output:
+	case Opcode::RelativeBaseOffset:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+// decode an instruction word
+template<typename Word>
+Instruction<Word> Decode(Word word)
+{
+	// split the instruction word into opcode and parameter modes
+	const Word opcode = word % 100; word /= 100;
+	const Word mode1 = word % 10; word /= 10;
+	const Word mode2 = word % 10; word /= 10;
+	const Word mode3 = word % 10; word /= 10;
+
+	Instruction<Word> instruction = {};
+
+	// unknown opcodes decode as 0 and fail when executed
+	switch (opcode)
+	{
+	case 1: case 2: case 3: case 4: case 5: case 6: case 7: case 8: case 9: case 99:
+		instruction.opcode = Opcode(opcode);
+		break;
+	default:
+		instruction.opcode = Opcode(0);
+		break;
+	}
+
+	// unknown modes behave as position mode
+	instruction.mode1 = mode1 == 1 || mode1 == 2 ? Mode(mode1) : Mode::Position;
+	instruction.mode2 = mode2 == 1 || mode2 == 2 ? Mode(mode2) : Mode::Position;
+	instruction.mode3 = mode3 == 1 || mode3 == 2 ? Mode(mode3) : Mode::Position;
+
+	return instruction;
+}
+
+// result of an instruction with two inputs and one output
+template<typename Word>
+Word Evaluate(Opcode opcode, Word a, Word b)
+{
+	switch (opcode)
+	{
+	case Opcode::Add:
+		return a + b;
+	case Opcode::Multiply:
+		return a * b;
+	case Opcode::LessThan:
+		return a < b;
+	default:
+		return a == b;
+	}
+}
+
+#include "Trace.h"
+#include "InputLog.h"
+#include "Checkpoint.h"
+
+template<typename Word, typename Memory = PagedMemory<Word>>
+class Computer
+{
+public:
+	Memory memory;
+	Word pc = 0;
+	Word relativebase = 0;
+	Channel<Word> input;
+	Channel<Word> output;
+#if INTCODE_PROFILE
+	Profile* profile = nullptr;
+#endif
+
+	// where to record the instructions run, if anywhere (see Trace.h)
+	Trace* trace = nullptr;
+
+	// where to record the input consumed, if anywhere (see InputLog.h)
+	InputLog* recording = nullptr;
+
+	// where to save checkpoints as the computer runs, if anywhere (see Checkpoint.h)
+	Checkpointer* checkpoints = nullptr;
+
+	// how to run the program, for comparing the interpreters
+	Dispatch dispatch = Dispatch::Best;
+
+	Computer() = default;
+
+	explicit Computer(const Memory& program)
+		: memory(program)
+	{
+	}
+
+	// copy the execution state, leaving the decoded instructions behind
+	// (paged memory is shared with the copy until either computer writes it,
+	// so forking is cheap however large the program is)
+	Computer Fork() const
+	{
+		Computer fork;
+		fork.memory = memory;
+		fork.pc = pc;
+		fork.relativebase = relativebase;
+		fork.input = input;
+		fork.output = output;
+		return fork;
+	}
+
+	// load a program and reset the execution state
+	void Load(const Memory& program)
+	{
+		memory = program;
+		pc = 0;
+		relativebase = 0;
+		input.clear();
+		output.clear();
+		decoded.clear();
+		code.clear();
+#if INTCODE_JIT
+		jit.Reset(0, nullptr);
+#endif
+	}
+
+	// write a word of memory from the host
+	// (writing memory directly once the program has started can leave stale decoded instructions)
+	void Poke(Word address, Word value)
+	{
+		Store(address, value);
+	}
+
+	// discard all decoded instructions
+	void Invalidate()
+	{
+		decoded.clear();
+		code.clear();
+#if INTCODE_JIT
+		jit.Reset(0, nullptr);
+#endif
+	}
+
+	// fill the decode cache from the pre-decoded section of a program image
+	// (see Image.h), two bytes to a word: opcode, or 0, and packed modes;
+	// the section is trusted to match the words, so only entries that are
+	// out of range or run past the end are left to decode as usual
+	void Predecode(const uint8_t* section, size_t count)
+	{
+		decoded.assign(memory.size(), Instruction<Word>());
+		code.assign(memory.size(), 0);
+#if INTCODE_JIT
+		jit.Reset(memory.size(), nullptr);
+#endif
+		count = std::min(count, decoded.size());
+		for (size_t address = 0; address < count; ++address)
+		{
+			const uint8_t opcode = section[2 * address];
+			const uint8_t modes = section[2 * address + 1];
+			if (!opcode || (opcode > uint8_t(Opcode::RelativeBaseOffset) && opcode != uint8_t(Opcode::Halt)))
+				continue;
+			if ((modes & 3) > 2 || (modes >> 2 & 3) > 2 || (modes >> 4 & 3) > 2 || modes >> 6)
+				continue;
+			const int length = InstructionLength(Opcode(opcode));
+			if (address + length > count)
+				continue;
+
+			Instruction<Word>& instruction = decoded[address];
+			instruction.opcode = Opcode(opcode);
+			instruction.mode1 = Mode(modes & 3);
+			instruction.mode2 = Mode(modes >> 2 & 3);
+			instruction.mode3 = Mode(modes >> 4 & 3);
+			instruction.span = uint8_t(length);
+			instruction.param1 = length > 1 ? Load(Word(address + 1)) : 0;
+			instruction.param2 = length > 2 ? Load(Word(address + 2)) : 0;
+			instruction.param3 = length > 3 ? Load(Word(address + 3)) : 0;
+#if INTCODE_FUSION
+			if (!trace && !recording)
+				Fuse(instruction, Word(address));
+#endif
+			for (size_t a = address; a < address + instruction.span && a < code.size(); ++a)
+				code[a] |= CodeDecoded;
+		}
+	}
+
+	// take a copy of the execution state
+	Checkpoint Snapshot() const
+	{
+		Checkpoint checkpoint;
+		checkpoint.wordSize = int(sizeof(Word));
+		checkpoint.pc = int64_t(pc);
+		checkpoint.relativebase = int64_t(relativebase);
+		checkpoint.SetMemory(memory);
+		for (size_t i = 0; i < input.size(); ++i)
+			checkpoint.input.push_back(int64_t(input[i]));
+		for (size_t i = 0; i < output.size(); ++i)
+			checkpoint.output.push_back(int64_t(output[i]));
+		return checkpoint;
+	}
+
+	// carry on from a checkpoint; false if it was taken from a computer with
+	// wider words
+	bool Restore(const Checkpoint& checkpoint)
+	{
+		if (size_t(checkpoint.wordSize) > sizeof(Word))
+			return false;
+		checkpoint.CopyTo(memory);
+		pc = Word(checkpoint.pc);
+		relativebase = Word(checkpoint.relativebase);
+		input.clear();
+		for (const int64_t value : checkpoint.input)
+			input.push_back(Word(value));
+		output.clear();
+		for (const int64_t value : checkpoint.output)
+			output.push_back(Word(value));
+		Invalidate();
+		return true;
+	}
+
+	// queue an input value
+	void Feed(Word value)
+	{
+		input.push_back(value);
+	}
+
+	// queue a range of input values
+	template<typename Iterator>
+	void Feed(Iterator first, Iterator last)
+	{
+		input.Push(first, last);
+	}
+
+	// take all pending output values
+	std::vector<Word> Drain()
+	{
+		std::vector<Word> values;
+		output.Drain(values);
+		return values;
+	}
+
+	// run one instruction
+	// (waiting for input is reported as State::Run)
+	State Step()
+	{
+		size_t outputs = SIZE_MAX;
+		const State state = Execute<true>(outputs);
+		return state == State::Wait ? State::Run : state;
+	}
+
+	// run until the program halts, fails, needs input that is not there,
+	// or has produced the given number of outputs
+	State RunUntil(size_t outputs = SIZE_MAX)
+	{
+		if (checkpoints && checkpoints->Due())
+		{
+			Checkpoint checkpoint = Snapshot();
+			checkpoints->Save(checkpoint);
+		}
+		if (trace || recording)
+			return Traced(outputs);
+#if INTCODE_PROFILE
+		return Execute<false>(outputs);
+#else
+		switch (dispatch)
+		{
+		case Dispatch::Switch:
+			return Execute<false>(outputs);
+#if INTCODE_THREADED
+		case Dispatch::Threaded:
+			return Threaded(outputs);
+#endif
+#if INTCODE_JIT
+		case Dispatch::Native:
+			return Native(outputs, std::is_same<Memory, PagedMemory<int64_t>>());
+#endif
+		default:
+			return Interpret(outputs);
+		}
+#endif
+	}
+
+	// run until the program halts, fails, or needs input
+	State Run()
+	{
+		return RunUntil();
+	}
+
+	// number of times a superinstruction has run
+	uint64_t Fused(Fusion fusion) const
+	{
+		return fusions[int(fusion) - int(Fusion::Set)];
+	}
+
+	// number of instructions run as part of a superinstruction
+	uint64_t FusedInstructions() const
+	{
+		uint64_t count = Fused(Fusion::Set) + Fused(Fusion::Goto);
+		for (Fusion fusion : { Fusion::TestJumpIfTrue, Fusion::TestJumpIfFalse, Fusion::AdjustJumpIfTrue, Fusion::AdjustJumpIfFalse })
+			count += 2 * Fused(fusion);
+		return count;
+	}
+
+	// write how often each superinstruction ran
+	void FusionReport(std::ostream& out) const
+	{
+		for (int f = 0; f < FusionCount; ++f)
+		{
+			const Fusion fusion = Fusion(int(Fusion::Set) + f);
+			out << FusionName(fusion) << ": " << Fused(fusion) << std::endl;
+		}
+		out << "fused instructions: " << FusedInstructions() << std::endl;
+	}
+
+private:
+	// decoded instruction for each address in the program image
+	std::vector<Instruction<Word>> decoded;
+
+	// marks addresses that hold part of a decoded or compiled instruction
+	std::vector<uint8_t> code;
+
+	// number of times each superinstruction has run
+	uint64_t fusions[FusionCount] = {};
+
+	template<bool Single> State Execute(size_t& outputs);
+	State Traced(size_t outputs);
+
+	// run with the fastest interpreter available
+	State Interpret(size_t outputs)
+	{
+#if INTCODE_THREADED
+		return Threaded(outputs);
+#else
+		return Execute<false>(outputs);
+#endif
+	}
+
+#if INTCODE_THREADED
+	State Threaded(size_t outputs);
+	static int HandlerIndex(const Instruction<Word>& instruction);
+#endif
+
+#if INTCODE_JIT
+	// native code compiled from the program image
+	Jit jit;
+
+	// largest program image grown to give compiled code flat memory
+	static constexpr size_t MaxNativeSize = 1 << 20;
+
+	// memory the compiler cannot address
+	State Native(size_t outputs, std::false_type)
+	{
+		return Interpret(outputs);
+	}
+
+	template<typename T = Word> State Native(size_t outputs, std::true_type);
+	template<typename T = Word> bool GrowFor(Word address);
+#endif
+
+	// read a word without writing to memory, so paged memory shared with a
+	// fork stays shared until one of them stores to it
+	Word Load(Word address) const
+	{
+		return Peek(memory, address);
+	}
+	static Word Peek(const std::vector<Word>& memory, Word address)
+	{
+		return memory[size_t(address)];
+	}
+	static Word Peek(const PagedMemory<Word>& memory, Word address)
+	{
+		return memory.Read(int64_t(address));
+	}
+
+	// decode the instruction at an address, including its parameter words
+	Instruction<Word> DecodeAt(Word address)
+	{
+		Instruction<Word> instruction = Decode(Load(address));
+		const int length = InstructionLength(instruction.opcode);
+		instruction.span = uint8_t(length);
+		if (length > 1)
+			instruction.param1 = Load(address + 1);
+		if (length > 2)
+			instruction.param2 = Load(address + 2);
+		if (length > 3)
+			instruction.param3 = Load(address + 3);
+		return instruction;
+	}
+
+	// combine an instruction with the one after it into a superinstruction,
+	// if they form one of the common patterns
+	void Fuse(Instruction<Word>& instruction, Word address)
+	{
+		const Opcode opcode = instruction.opcode;
+		switch (opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			if (instruction.mode1 == Mode::Immediate && instruction.mode2 == Mode::Immediate)
+			{
+				// store a constant
+				instruction.fusion = Fusion::Set;
+				instruction.param1 = Evaluate(opcode, instruction.param1, instruction.param2);
+				return;
+			}
+			if (size_t(address) + 7 <= decoded.size())
+			{
+				// jump on the result
+				const Instruction<Word> next = DecodeAt(address + 4);
+				const Mode output = instruction.mode3 == Mode::Immediate ? Mode::Position : instruction.mode3;
+				if ((next.opcode == Opcode::JumpIfTrue || next.opcode == Opcode::JumpIfFalse) && next.mode1 == output && next.param1 == instruction.param3)
+				{
+					instruction.fusion = next.opcode == Opcode::JumpIfTrue ? Fusion::TestJumpIfTrue : Fusion::TestJumpIfFalse;
+					instruction.mode4 = next.mode2;
+					instruction.param4 = next.param2;
+					instruction.span = 7;
+				}
+			}
+			return;
+
+		case Opcode::JumpIfTrue:
+		case Opcode::JumpIfFalse:
+			if (instruction.mode1 == Mode::Immediate && (instruction.param1 != 0) == (opcode == Opcode::JumpIfTrue))
+				instruction.fusion = Fusion::Goto;
+			return;
+
+		case Opcode::RelativeBaseOffset:
+			if (instruction.mode1 == Mode::Immediate && size_t(address) + 5 <= decoded.size())
+			{
+				// adjust the relative base, then jump
+				const Instruction<Word> next = DecodeAt(address + 2);
+				if (next.opcode == Opcode::JumpIfTrue || next.opcode == Opcode::JumpIfFalse)
+				{
+					instruction.fusion = next.opcode == Opcode::JumpIfTrue ? Fusion::AdjustJumpIfTrue : Fusion::AdjustJumpIfFalse;
+					instruction.mode2 = next.mode1;
+					instruction.param2 = next.param1;
+					instruction.mode3 = next.mode2;
+					instruction.param3 = next.param2;
+					instruction.span = 5;
+				}
+			}
+			return;
+
+		default:
+			return;
+		}
+	}
+
+	// get the decoded instruction at an address
+	Instruction<Word>& Fetch(Word address)
+	{
+		if (size_t(address) < decoded.size())
+		{
+			Instruction<Word>& instruction = decoded[size_t(address)];
+			if (instruction.opcode == Opcode(0))
+			{
+				instruction = DecodeAt(address);
+#if INTCODE_FUSION
+				if (!trace && !recording)
+					Fuse(instruction, address);
+#endif
+				const size_t end = std::min(size_t(address) + instruction.span, code.size());
+				for (size_t a = size_t(address); a < end; ++a)
+					code[a] |= CodeDecoded;
+			}
+			return instruction;
+		}
+		scratch = DecodeAt(address);
+		return scratch;
+	}
+
+	// decoded instruction outside the program image
+	Instruction<Word> scratch;
+
+	// write a word, invalidating any instruction decoded from it
+	void Store(Word address, Word value)
+	{
+		INTCODE_PROFILED(Write(int64_t(address)));
+		memory[address] = value;
+		if (size_t(address) < code.size() && code[size_t(address)])
+			InvalidateAt(size_t(address));
+	}
+
+	// discard the decoded instructions that overlap an address
+	void InvalidateAt(size_t address)
+	{
+#if INTCODE_JIT
+		if (code[address] & CodeCompiled)
+			jit.Invalidate(address, code.data());
+#endif
+		code[address] &= ~CodeDecoded;
+		for (size_t start = address >= MaxSpan - 1 ? address - (MaxSpan - 1) : 0; start <= address; ++start)
+		{
+			if (start + decoded[start].span > address)
+				decoded[start] = Instruction<Word>();
+		}
+	}
+
+	// read a parameter
+	Word Read(Mode mode, Word value, Word base)
+	{
+		switch (mode)
+		{
+		case Mode::Position:
+			INTCODE_PROFILED(Read(int64_t(value)));
+			return Load(value);
+		case Mode::Relative:
+			INTCODE_PROFILED(Read(int64_t(base + value)));
+			return Load(base + value);
+		default:
+			return value;
+		}
+	}
+
+	// address written by a parameter
+	static Word Address(Mode mode, Word value, Word base)
+	{
+		if (mode == Mode::Relative)
+			value += base;
+		return value;
+	}
+};
+
+// run instructions with the program counter and relative base held in locals
+// Single runs one instruction
+template<typename Word, typename Memory>
+template<bool Single>
+State Computer<Word, Memory>::Execute(size_t& outputs)
+{
+	if (decoded.size() != memory.size())
+	{
+		decoded.assign(memory.size(), Instruction<Word>());
+		code.assign(memory.size(), 0);
+	}
+
+	Word ip = pc;
+	Word base = relativebase;
+
+	State state = State::Run;
+	do
+	{
+		const Instruction<Word>& i = Fetch(ip);
+		INTCODE_PROFILED(Instruction(int64_t(ip), i.opcode));
+
+		switch (i.fusion == Fusion::None ? int(i.opcode) : int(i.fusion))
+		{
+		case int(Opcode::Add):
+			Store(Address(i.mode3, i.param3, base), Read(i.mode1, i.param1, base) + Read(i.mode2, i.param2, base));
+			ip += 4;
+			break;
+
+		case int(Opcode::Multiply):
+			Store(Address(i.mode3, i.param3, base), Read(i.mode1, i.param1, base) * Read(i.mode2, i.param2, base));
+			ip += 4;
+			break;
+
+		case int(Opcode::Input):
+			if (input.empty())
+			{
+				// wait for input
+				state = State::Wait;
+				break;
+			}
+			Store(Address(i.mode1, i.param1, base), input.Pop());
+			ip += 2;
+			break;
+
+		case int(Opcode::Output):
+			output.push_back(Read(i.mode1, i.param1, base));
+			ip += 2;
+			if (--outputs == 0)
+				state = State::Output;
+			break;
+
+		case int(Opcode::JumpIfTrue):
+		case int(Opcode::JumpIfFalse):
+			{
+				const bool taken = (Read(i.mode1, i.param1, base) != 0) == (i.opcode == Opcode::JumpIfTrue);
+				INTCODE_PROFILED(Branch(int64_t(ip), taken));
+				ip = taken ? Read(i.mode2, i.param2, base) : ip + 3;
+			}
+			break;
+
+		case int(Opcode::LessThan):
+			Store(Address(i.mode3, i.param3, base), Read(i.mode1, i.param1, base) < Read(i.mode2, i.param2, base));
+			ip += 4;
+			break;
+
+		case int(Opcode::Equals):
+			Store(Address(i.mode3, i.param3, base), Read(i.mode1, i.param1, base) == Read(i.mode2, i.param2, base));
+			ip += 4;
+			break;
+
+		case int(Opcode::RelativeBaseOffset):
+			{
+				const Word offset = Read(i.mode1, i.param1, base);
+				INTCODE_PROFILED(AdjustBase(int64_t(ip), int64_t(offset)));
+				base += offset;
+			}
+			ip += 2;
+			break;
+
+		case int(Opcode::Halt):
+			state = State::Halt;
+			break;
+
+		case int(Fusion::Set):
+			++fusions[int(i.fusion) - int(Fusion::Set)];
+			Store(Address(i.mode3, i.param3, base), i.param1);
+			ip += 4;
+			break;
+
+		case int(Fusion::Goto):
+			++fusions[int(i.fusion) - int(Fusion::Set)];
+			ip = Read(i.mode2, i.param2, base);
+			break;
+
+		case int(Fusion::TestJumpIfTrue):
+		case int(Fusion::TestJumpIfFalse):
+			{
+				++fusions[int(i.fusion) - int(Fusion::Set)];
+				const bool ifTrue = i.fusion == Fusion::TestJumpIfTrue;
+				const Word value = Evaluate(i.opcode, Read(i.mode1, i.param1, base), Read(i.mode2, i.param2, base));
+				Store(Address(i.mode3, i.param3, base), value);
+				if (i.span == 0)
+					ip += 4;	// the store changed this instruction or the jump
+				else
+					ip = (value != 0) == ifTrue ? Read(i.mode4, i.param4, base) : ip + 7;
+			}
+			break;
+
+		case int(Fusion::AdjustJumpIfTrue):
+		case int(Fusion::AdjustJumpIfFalse):
+			++fusions[int(i.fusion) - int(Fusion::Set)];
+			base += i.param1;
+			ip = (Read(i.mode2, i.param2, base) != 0) == (i.fusion == Fusion::AdjustJumpIfTrue) ? Read(i.mode3, i.param3, base) : ip + 5;
+			break;
+
+		default:
+			state = State::Error;
+			break;
+		}
+	}
+	while (!Single && state == State::Run);
+
+	pc = ip;
+	relativebase = base;
+	return state;
+}
+
+// run instructions one at a time, recording them in the trace and the input
+// log, until the program halts, fails, needs input, or has produced the given
+// number of outputs
+template<typename Word, typename Memory>
+State Computer<Word, Memory>::Traced(size_t outputs)
+{
+	if (decoded.size() != memory.size())
+	{
+		decoded.assign(memory.size(), Instruction<Word>());
+		code.assign(memory.size(), 0);
+	}
+
+	Word ip = pc;
+	Word base = relativebase;
+
+	uint64_t executed = 0;
+	State state = State::Run;
+	do
+	{
+		// instructions fused before tracing or recording began are decoded again
+		Instruction<Word> i = Fetch(ip);
+		if (i.fusion != Fusion::None)
+			i = DecodeAt(ip);
+
+		int64_t values[3];
+		switch (i.opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			{
+				const Word a = Read(i.mode1, i.param1, base);
+				const Word b = Read(i.mode2, i.param2, base);
+				const Word target = Address(i.mode3, i.param3, base);
+				values[0] = int64_t(a);
+				values[1] = int64_t(b);
+				values[2] = int64_t(target);
+				if (trace)
+					trace->Record(int64_t(ip), i.opcode, values, 3);
+				Store(target, Evaluate(i.opcode, a, b));
+				ip += 4;
+			}
+			break;
+
+		case Opcode::Input:
+			if (input.empty())
+			{
+				// wait for input
+				state = State::Wait;
+				break;
+			}
+			values[0] = int64_t(Address(i.mode1, i.param1, base));
+			values[1] = int64_t(input.front());
+			if (trace)
+				trace->Record(int64_t(ip), i.opcode, values, 2);
+			if (recording)
+				recording->Input(recording->Instructions() + executed, values[1]);
+			Store(Address(i.mode1, i.param1, base), input.Pop());
+			ip += 2;
+			break;
+
+		case Opcode::Output:
+			output.push_back(Read(i.mode1, i.param1, base));
+			values[0] = int64_t(output.back());
+			if (trace)
+				trace->Record(int64_t(ip), i.opcode, values, 1);
+			if (recording)
+				recording->Output(values[0]);
+			ip += 2;
+			if (--outputs == 0)
+				state = State::Output;
+			break;
+
+		case Opcode::JumpIfTrue:
+		case Opcode::JumpIfFalse:
+			{
+				const Word condition = Read(i.mode1, i.param1, base);
+				const Word target = Read(i.mode2, i.param2, base);
+				values[0] = int64_t(condition);
+				values[1] = int64_t(target);
+				if (trace)
+					trace->Record(int64_t(ip), i.opcode, values, 2);
+				ip = (condition != 0) == (i.opcode == Opcode::JumpIfTrue) ? target : ip + 3;
+			}
+			break;
+
+		case Opcode::RelativeBaseOffset:
+			values[0] = int64_t(Read(i.mode1, i.param1, base));
+			if (trace)
+				trace->Record(int64_t(ip), i.opcode, values, 1);
+			base += Word(values[0]);
+			ip += 2;
+			break;
+
+		case Opcode::Halt:
+			if (trace)
+				trace->Record(int64_t(ip), i.opcode, values, 0);
+			state = State::Halt;
+			break;
+
+		default:
+			if (trace)
+				trace->Fault(int64_t(ip), int64_t(Load(ip)));
+			state = State::Error;
+			break;
+		}
+
+		if (state != State::Wait && state != State::Error)
+			++executed;
+	}
+	while (state == State::Run);
+
+	if (recording)
+		recording->Ran(executed);
+	pc = ip;
+	relativebase = base;
+	return state;
+}
+
+#if INTCODE_THREADED
+#include "Threaded.h"
+#endif
+
+#if INTCODE_JIT
+// run compiled code, interpreting the instructions it hands back, until the
+// program halts, fails, needs input, or has produced the given number of outputs
+template<typename Word, typename Memory>
+template<typename T>
+State Computer<Word, Memory>::Native(size_t outputs, std::true_type)
+{
+	for (;;)
+	{
+		if (decoded.size() != memory.size() || jit.Size() != memory.size())
+		{
+			if (jit.Size() && decoded.size() == jit.Size() && memory.size() > jit.Size())
+			{
+				// the image grew, which leaves what was decoded and compiled valid
+				decoded.resize(memory.size());
+				code.resize(memory.size(), 0);
+				jit.Grow(memory.size());
+			}
+			else
+			{
+				decoded.assign(memory.size(), Instruction<Word>());
+				code.assign(memory.size(), 0);
+				jit.Reset(memory.size(), nullptr);
+			}
+		}
+		if (!jit.Ready())
+			return Interpret(outputs);
+
+		JitContext context = { memory.data(), int64_t(memory.size()), pc, relativebase, code.data(), jit.Blocks(), 0 };
+		const JitExit exit = jit.Run(context);
+		pc = context.pc;
+		relativebase = context.base;
+
+		switch (exit)
+		{
+		case JitExit::Miss:
+			if (jit.Compile(memory.data(), memory.size(), pc, code.data()))
+				break;
+			// fall through
+
+		case JitExit::Interpret:
+			if (!GrowFor(pc))
+			{
+				// carry on interpreting through code the compiler has given up on
+				do
+				{
+					const State state = Execute<true>(outputs);
+					if (state != State::Run)
+						return state;
+				}
+				while (jit.Rejected(pc));
+			}
+			break;
+
+		case JitExit::Modified:
+			InvalidateAt(size_t(context.address));
+			break;
+		}
+	}
+}
+
+// grow the program image to cover the memory an instruction reaches past its
+// end, so compiled code can run it; returns false if nothing changed
+template<typename Word, typename Memory>
+template<typename T>
+bool Computer<Word, Memory>::GrowFor(Word address)
+{
+	if (size_t(address) >= memory.size())
+		return false;
+
+	const Instruction<Word> i = DecodeAt(address);
+	const Mode modes[3] = { i.mode1, i.mode2, i.mode3 == Mode::Immediate ? Mode::Position : i.mode3 };
+	size_t reach = 0;
+	for (int p = 1; p < InstructionLength(i.opcode); ++p)
+	{
+		if (modes[p - 1] == Mode::Immediate)
+			continue;
+		const Word target = Address(modes[p - 1], Load(address + p), relativebase);
+		if (size_t(target) >= memory.size() && size_t(target) < MaxNativeSize)
+			reach = std::max(reach, size_t(target) + 1);
+	}
+	if (!reach)
+		return false;
+
+	const size_t page = Memory::PageSize;
+	memory.Grow(std::min((std::max(reach, memory.size() * 2) + page - 1) / page * page, size_t(MaxNativeSize)));
+	return true;
+}
+#endif
+
+// the configurations used by the days are compiled into the library
+extern template class Computer<int, std::vector<int>>;
+extern template class Computer<int64_t, PagedMemory<int64_t>>;
@@ -0,0 +1,796 @@
+#include "Jit.h"
+
+#if INTCODE_JIT
+
+#include "Intcode.h"
+
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#include <sys/mman.h>
+
+namespace
+{
+	// size of the executable arena
+	const size_t ArenaSize = 4 << 20;
+
+	// most instructions compiled into one block
+	const int MaxBlockInstructions = 256;
+
+	// times a block can be dropped before its address is left to the interpreter
+	const uint8_t MaxDrops = 2;
+
+	enum Register
+	{
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15,
+		NoIndex = -1
+	};
+
+	// registers that hold machine state while compiled code runs
+	// (all callee-saved, so the entry stub saves them for its caller)
+	const Register ContextRegister = R12;
+	const Register MemoryRegister = R13;
+	const Register SizeRegister = R14;
+	const Register BaseRegister = R15;
+	const Register CodeRegister = RBX;
+	const Register BlocksRegister = RBP;
+
+	// first integer argument in the System V calling convention
+	const Register ArgumentRegister = RDI;
+
+	enum class Condition : uint8_t
+	{
+		AboveEqual = 0x3,
+		Equal = 0x4,
+		NotEqual = 0x5,
+		Less = 0xC,
+	};
+
+	enum class Alu : uint8_t
+	{
+		Add = 0x01,
+		Cmp = 0x39,
+		Test = 0x85,
+		Mov = 0x89,
+	};
+
+	// x86-64 machine code, assembled for a known final address
+	class Assembler
+	{
+	public:
+		std::vector<uint8_t> bytes;
+
+		explicit Assembler(uint8_t* origin)
+			: origin(origin)
+		{
+		}
+
+		size_t Position() const
+		{
+			return bytes.size();
+		}
+
+		uint8_t* Address(size_t position) const
+		{
+			return origin + position;
+		}
+
+		void Byte(int value)
+		{
+			bytes.push_back(uint8_t(value));
+		}
+
+		void Int32(int32_t value)
+		{
+			for (int shift = 0; shift < 32; shift += 8)
+				Byte(uint32_t(value) >> shift);
+		}
+
+		void Int64(int64_t value)
+		{
+			for (int shift = 0; shift < 64; shift += 8)
+				Byte(uint64_t(value) >> shift);
+		}
+
+		// mov dst, [base + index * (1 << scale) + disp]
+		void Load(Register dst, Register base, Register index, int scale, int32_t disp)
+		{
+			Memory(true, 0x8B, dst, base, index, scale, disp);
+		}
+
+		// mov [base + index * (1 << scale) + disp], src
+		void Store(Register base, Register index, int scale, int32_t disp, Register src)
+		{
+			Memory(true, 0x89, src, base, index, scale, disp);
+		}
+
+		// mov qword [base + disp], imm32
+		void StoreImmediate(Register base, int32_t disp, int32_t value)
+		{
+			Memory(true, 0xC7, RAX, base, NoIndex, 0, disp);
+			Int32(value);
+		}
+
+		// lea dst, [base + disp]
+		void Lea(Register dst, Register base, int32_t disp)
+		{
+			Memory(true, 0x8D, dst, base, NoIndex, 0, disp);
+		}
+
+		// cmp byte [base + index + disp], imm8
+		void CompareByte(Register base, Register index, int32_t disp, int value)
+		{
+			Memory(false, 0x80, Register(7), base, index, 0, disp);
+			Byte(value);
+		}
+
+		// mov dst, imm
+		void Move(Register dst, int64_t value)
+		{
+			if (value >= INT32_MIN && value <= INT32_MAX)
+			{
+				Rex(true, RAX, NoIndex, dst);
+				Byte(0xC7);
+				Direct(RAX, dst);
+				Int32(int32_t(value));
+			}
+			else
+			{
+				Rex(true, RAX, NoIndex, dst);
+				Byte(0xB8 + (dst & 7));
+				Int64(value);
+			}
+		}
+
+		// mov dst32, imm32
+		void Move32(Register dst, int32_t value)
+		{
+			Rex(false, RAX, NoIndex, dst);
+			Byte(0xB8 + (dst & 7));
+			Int32(value);
+		}
+
+		// mov dst, src
+		void Move(Register dst, Register src)
+		{
+			Arithmetic(Alu::Mov, dst, src);
+		}
+
+		// op dst, src
+		void Arithmetic(Alu op, Register dst, Register src)
+		{
+			Rex(true, src, NoIndex, dst);
+			Byte(int(op));
+			Direct(src, dst);
+		}
+
+		// add dst, imm32
+		void AddImmediate(Register dst, int32_t value)
+		{
+			Rex(true, RAX, NoIndex, dst);
+			Byte(0x81);
+			Direct(RAX, dst);
+			Int32(value);
+		}
+
+		// imul dst, src
+		void Multiply(Register dst, Register src)
+		{
+			Rex(true, dst, NoIndex, src);
+			Byte(0x0F);
+			Byte(0xAF);
+			Direct(dst, src);
+		}
+
+		// rax = condition ? 1 : 0
+		void Set(Condition condition)
+		{
+			Byte(0x0F);
+			Byte(0x90 | int(condition));
+			Direct(RAX, RAX);
+			Byte(0x0F);
+			Byte(0xB6);
+			Direct(RAX, RAX);
+		}
+
+		// jcc rel32, returning the position of the displacement
+		size_t Jump(Condition condition)
+		{
+			Byte(0x0F);
+			Byte(0x80 | int(condition));
+			Int32(0);
+			return Position() - 4;
+		}
+
+		// jmp rel32, returning the position of the displacement
+		size_t Jump()
+		{
+			Byte(0xE9);
+			Int32(0);
+			return Position() - 4;
+		}
+
+		// jcc or jmp to an absolute address
+		void Jump(Condition condition, const uint8_t* target)
+		{
+			Patch(Jump(condition), target);
+		}
+		void Jump(const uint8_t* target)
+		{
+			Patch(Jump(), target);
+		}
+
+		// jmp reg
+		void Jump(Register target)
+		{
+			Rex(false, RAX, NoIndex, target);
+			Byte(0xFF);
+			Direct(Register(4), target);
+		}
+
+		// point a jump displacement at a target
+		void Patch(size_t position, const uint8_t* target)
+		{
+			const int64_t displacement = target - Address(position + 4);
+			for (int shift = 0; shift < 32; shift += 8)
+				bytes[position + shift / 8] = uint8_t(uint64_t(displacement) >> shift);
+		}
+
+		// point a jump displacement at the current position
+		void Patch(size_t position)
+		{
+			Patch(position, Address(Position()));
+		}
+
+		void Push(Register reg)
+		{
+			Rex(false, RAX, NoIndex, reg);
+			Byte(0x50 + (reg & 7));
+		}
+
+		void Pop(Register reg)
+		{
+			Rex(false, RAX, NoIndex, reg);
+			Byte(0x58 + (reg & 7));
+		}
+
+		void Return()
+		{
+			Byte(0xC3);
+		}
+
+	private:
+		uint8_t* origin;
+
+		// REX prefix, left out when it has no bits set
+		void Rex(bool wide, Register reg, Register index, Register base)
+		{
+			const int rex = 0x40 | (wide ? 8 : 0) | (reg & 8) >> 1 | (index != NoIndex ? (index & 8) >> 2 : 0) | (base & 8) >> 3;
+			if (rex != 0x40)
+				Byte(rex);
+		}
+
+		// register to register operand
+		void Direct(Register reg, Register rm)
+		{
+			Byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+		}
+
+		// instruction with a memory operand
+		void Memory(bool wide, int opcode, Register reg, Register base, Register index, int scale, int32_t disp)
+		{
+			Rex(wide, reg, index, base);
+			Byte(opcode);
+
+			// rbp and r13 bases always take a displacement
+			const int mod = disp == 0 && (base & 7) != RBP ? 0 : disp >= -128 && disp < 128 ? 1 : 2;
+
+			// rsp and r12 bases always take a SIB byte
+			if (index == NoIndex && (base & 7) != RSP)
+			{
+				Byte(mod << 6 | (reg & 7) << 3 | (base & 7));
+			}
+			else
+			{
+				Byte(mod << 6 | (reg & 7) << 3 | RSP);
+				Byte(scale << 6 | (index == NoIndex ? RSP : index & 7) << 3 | (base & 7));
+			}
+
+			if (mod == 1)
+				Byte(disp);
+			else if (mod == 2)
+				Int32(disp);
+		}
+	};
+
+	// side exit from a block, emitted after the block's main path
+	struct Exit
+	{
+		size_t jump;
+		int64_t pc;
+		JitExit reason;
+		Register address;	// register holding the written address, or NoIndex
+		int64_t constant;	// written address when there is no register
+	};
+
+	// compiles one block of instructions
+	class BlockCompiler
+	{
+	public:
+		BlockCompiler(Assembler& assembler, const int64_t* memory, size_t size, const uint8_t* dispatch, const uint8_t* exit)
+			: a(assembler), memory(memory), size(size), dispatch(dispatch), exit(exit)
+		{
+		}
+
+		// returns the address past the last compiled instruction
+		int64_t Compile(int64_t start)
+		{
+			int64_t ip = start;
+			for (int count = 0; ; ++count)
+			{
+				if (uint64_t(ip) >= size || count == MaxBlockInstructions)
+				{
+					Chain(ip);
+					break;
+				}
+
+				const Instruction<int64_t> i = Decode(memory[ip]);
+				const int length = InstructionLength(i.opcode);
+				if (uint64_t(ip) + length > size || !Compilable(ip, i, length))
+				{
+					if (count == 0)
+						return start;
+					Leave(ip, JitExit::Interpret);
+					break;
+				}
+
+				labels.push_back(std::make_pair(ip, a.Position()));
+				const int64_t p1 = length > 1 ? memory[ip + 1] : 0;
+				const int64_t p2 = length > 2 ? memory[ip + 2] : 0;
+				const int64_t p3 = length > 3 ? memory[ip + 3] : 0;
+				const int64_t next = ip + length;
+
+				switch (i.opcode)
+				{
+				case Opcode::Add:
+				case Opcode::Multiply:
+				case Opcode::LessThan:
+				case Opcode::Equals:
+					Read(RAX, i.mode1, p1, ip);
+					Read(RDX, i.mode2, p2, ip);
+					switch (i.opcode)
+					{
+					case Opcode::Add:
+						a.Arithmetic(Alu::Add, RAX, RDX);
+						break;
+					case Opcode::Multiply:
+						a.Multiply(RAX, RDX);
+						break;
+					case Opcode::LessThan:
+						a.Arithmetic(Alu::Cmp, RAX, RDX);
+						a.Set(Condition::Less);
+						break;
+					default:
+						a.Arithmetic(Alu::Cmp, RAX, RDX);
+						a.Set(Condition::Equal);
+						break;
+					}
+					Write(i.mode3, p3, ip, next);
+					break;
+
+				case Opcode::JumpIfTrue:
+				case Opcode::JumpIfFalse:
+					{
+						const bool ifTrue = i.opcode == Opcode::JumpIfTrue;
+						if (i.mode1 == Mode::Immediate)
+						{
+							// a constant condition either always jumps or never does
+							if ((p1 != 0) == ifTrue)
+							{
+								Goto(i.mode2, p2, ip);
+								return Finish(next);
+							}
+							break;
+						}
+						Read(RAX, i.mode1, p1, ip);
+						a.Arithmetic(Alu::Test, RAX, RAX);
+						const size_t skip = a.Jump(ifTrue ? Condition::Equal : Condition::NotEqual);
+						Goto(i.mode2, p2, ip);
+						a.Patch(skip);
+					}
+					break;
+
+				case Opcode::RelativeBaseOffset:
+					if (i.mode1 == Mode::Immediate && p1 >= INT32_MIN && p1 <= INT32_MAX)
+					{
+						a.AddImmediate(BaseRegister, int32_t(p1));
+					}
+					else
+					{
+						Read(RAX, i.mode1, p1, ip);
+						a.Arithmetic(Alu::Add, BaseRegister, RAX);
+					}
+					break;
+
+				default:
+					break;
+				}
+
+				ip = next;
+			}
+			return Finish(ip);
+		}
+
+	private:
+		Assembler& a;
+		const int64_t* memory;
+		size_t size;
+		const uint8_t* dispatch;
+		const uint8_t* exit;
+		std::vector<Exit> exits;
+		std::vector<std::pair<int64_t, size_t>> labels;
+
+		// emit the side exits and return the end of the block
+		int64_t Finish(int64_t end)
+		{
+			for (const Exit& side : exits)
+			{
+				a.Patch(side.jump);
+				if (side.reason == JitExit::Modified)
+				{
+					if (side.address != NoIndex)
+						a.Store(ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, address)), side.address);
+					else
+						a.StoreImmediate(ContextRegister, int32_t(offsetof(JitContext, address)), int32_t(side.constant));
+				}
+				Leave(side.pc, side.reason);
+			}
+			return end;
+		}
+
+		// a parameter compiled code can reach without leaving the flat image
+		bool Reachable(Mode mode, int64_t value) const
+		{
+			switch (mode)
+			{
+			case Mode::Position:
+				return uint64_t(value) < size && value < (1 << 28);
+			case Mode::Relative:
+				return value >= INT32_MIN && value <= INT32_MAX;
+			default:
+				return true;
+			}
+		}
+
+		// the instruction at ip can be compiled
+		bool Compilable(int64_t ip, const Instruction<int64_t>& i, int length) const
+		{
+			switch (i.opcode)
+			{
+			case Opcode::Add:
+			case Opcode::Multiply:
+			case Opcode::LessThan:
+			case Opcode::Equals:
+			case Opcode::JumpIfTrue:
+			case Opcode::JumpIfFalse:
+			case Opcode::RelativeBaseOffset:
+				break;
+			default:
+				return false;
+			}
+			// immediate mode outputs behave as position mode
+			const Mode modes[3] = { i.mode1, i.mode2, i.mode3 == Mode::Immediate ? Mode::Position : i.mode3 };
+			for (int p = 1; p < length; ++p)
+			{
+				if (!Reachable(modes[p - 1], memory[ip + p]))
+					return false;
+			}
+			return true;
+		}
+
+		// leave compiled code
+		void Leave(int64_t pc, JitExit reason)
+		{
+			a.Move(RAX, pc);
+			a.Move32(RDX, int32_t(reason));
+			a.Jump(exit);
+		}
+
+		// continue at a constant address
+		void Chain(int64_t pc)
+		{
+			a.Move(RAX, pc);
+			a.Jump(dispatch);
+		}
+
+		// jump to the address in a parameter
+		void Goto(Mode mode, int64_t value, int64_t ip)
+		{
+			if (mode == Mode::Immediate)
+			{
+				// backward jumps within the block go straight to the target
+				for (const auto& label : labels)
+				{
+					if (label.first == value)
+					{
+						a.Jump(a.Address(label.second));
+						return;
+					}
+				}
+				Chain(value);
+				return;
+			}
+			Read(RAX, mode, value, ip);
+			a.Jump(dispatch);
+		}
+
+		// compute the address of a relative parameter in rcx, leaving if
+		// it is outside the flat image
+		void RelativeAddress(int64_t value, int64_t ip)
+		{
+			a.Lea(RCX, BaseRegister, int32_t(value));
+			a.Arithmetic(Alu::Cmp, RCX, SizeRegister);
+			exits.push_back({ a.Jump(Condition::AboveEqual), ip, JitExit::Interpret, NoIndex, 0 });
+		}
+
+		// load a parameter
+		void Read(Register dst, Mode mode, int64_t value, int64_t ip)
+		{
+			switch (mode)
+			{
+			case Mode::Position:
+				a.Load(dst, MemoryRegister, NoIndex, 0, int32_t(value * 8));
+				break;
+			case Mode::Relative:
+				RelativeAddress(value, ip);
+				a.Load(dst, MemoryRegister, RCX, 3, 0);
+				break;
+			default:
+				a.Move(dst, value);
+				break;
+			}
+		}
+
+		// store rax to a parameter, leaving if it overwrote code
+		void Write(Mode mode, int64_t value, int64_t ip, int64_t next)
+		{
+			if (mode == Mode::Relative)
+			{
+				RelativeAddress(value, ip);
+				a.Store(MemoryRegister, RCX, 3, 0, RAX);
+				a.CompareByte(CodeRegister, RCX, 0, 0);
+				exits.push_back({ a.Jump(Condition::NotEqual), next, JitExit::Modified, RCX, 0 });
+			}
+			else
+			{
+				a.Store(MemoryRegister, NoIndex, 0, int32_t(value * 8), RAX);
+				a.CompareByte(CodeRegister, NoIndex, int32_t(value), 0);
+				exits.push_back({ a.Jump(Condition::NotEqual), next, JitExit::Modified, NoIndex, value });
+			}
+		}
+	};
+
+	uint8_t* AllocateExecutable(size_t size)
+	{
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return memory != MAP_FAILED ? static_cast<uint8_t*>(memory) : nullptr;
+	}
+
+	void FreeExecutable(uint8_t* memory, size_t size)
+	{
+		munmap(memory, size);
+	}
+}
+
+Jit::Jit()
+{
+}
+
+Jit::Jit(const Jit&)
+{
+}
+
+Jit::Jit(Jit&& other)
+	: arena(other.arena), capacity(other.capacity), used(other.used), stubs(other.stubs)
+	, entry(other.entry), exit(other.exit), dispatch(other.dispatch)
+	, blocks(std::move(other.blocks)), ranges(std::move(other.ranges)), drops(std::move(other.drops))
+{
+	other.arena = nullptr;
+	other.capacity = 0;
+	other.blocks.clear();
+	other.ranges.clear();
+	other.drops.clear();
+}
+
+Jit::~Jit()
+{
+	if (arena)
+		FreeExecutable(arena, capacity);
+}
+
+Jit& Jit::operator=(const Jit&)
+{
+	Reset(0, nullptr);
+	return *this;
+}
+
+Jit& Jit::operator=(Jit&& other)
+{
+	std::swap(arena, other.arena);
+	std::swap(capacity, other.capacity);
+	std::swap(used, other.used);
+	std::swap(stubs, other.stubs);
+	std::swap(entry, other.entry);
+	std::swap(exit, other.exit);
+	std::swap(dispatch, other.dispatch);
+	blocks.swap(other.blocks);
+	ranges.swap(other.ranges);
+	drops.swap(other.drops);
+	return *this;
+}
+
+void Jit::Reset(size_t size, uint8_t* code)
+{
+	if (code)
+	{
+		for (const Range& range : ranges)
+		{
+			for (int64_t address = range.start; address < range.end; ++address)
+				code[address] &= ~CodeCompiled;
+		}
+	}
+	ranges.clear();
+	blocks.assign(size, nullptr);
+	drops.assign(size, 0);
+
+	if (size && !arena)
+	{
+		arena = AllocateExecutable(ArenaSize);
+		if (arena)
+		{
+			capacity = ArenaSize;
+			EmitStubs();
+		}
+	}
+	used = stubs;
+}
+
+void Jit::Grow(size_t size)
+{
+	if (size <= blocks.size())
+		return;
+	blocks.resize(size, nullptr);
+	drops.resize(size, 0);
+}
+
+bool Jit::Rejected(int64_t pc) const
+{
+	return uint64_t(pc) < blocks.size() && !blocks[size_t(pc)] && drops[size_t(pc)] >= MaxDrops;
+}
+
+void Jit::EmitStubs()
+{
+	Assembler a(arena);
+
+	// entry: save registers, load the machine state, and dispatch
+	entry = a.Address(a.Position());
+	a.Push(RBX);
+	a.Push(RBP);
+	a.Push(R12);
+	a.Push(R13);
+	a.Push(R14);
+	a.Push(R15);
+	a.Move(ContextRegister, ArgumentRegister);
+	a.Load(MemoryRegister, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, memory)));
+	a.Load(SizeRegister, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, size)));
+	a.Load(BaseRegister, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, base)));
+	a.Load(CodeRegister, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, code)));
+	a.Load(BlocksRegister, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, blocks)));
+	a.Load(RAX, ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, pc)));
+
+	// dispatch: jump to the block for the address in rax
+	dispatch = a.Address(a.Position());
+	a.Arithmetic(Alu::Cmp, RAX, SizeRegister);
+	const size_t outside = a.Jump(Condition::AboveEqual);
+	a.Load(RDX, BlocksRegister, RAX, 3, 0);
+	a.Arithmetic(Alu::Test, RDX, RDX);
+	const size_t missing = a.Jump(Condition::Equal);
+	a.Jump(RDX);
+	a.Patch(outside);
+	a.Patch(missing);
+	a.Move32(RDX, int32_t(JitExit::Miss));
+
+	// exit: store the machine state and return the reason in edx
+	exit = a.Address(a.Position());
+	a.Store(ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, pc)), RAX);
+	a.Store(ContextRegister, NoIndex, 0, int32_t(offsetof(JitContext, base)), BaseRegister);
+	a.Move(RAX, RDX);
+	a.Pop(R15);
+	a.Pop(R14);
+	a.Pop(R13);
+	a.Pop(R12);
+	a.Pop(RBP);
+	a.Pop(RBX);
+	a.Return();
+
+	std::memcpy(arena, a.bytes.data(), a.bytes.size());
+	stubs = a.bytes.size();
+}
+
+bool Jit::Compile(const int64_t* memory, size_t size, int64_t pc, uint8_t* code)
+{
+	if (!arena || uint64_t(pc) >= blocks.size() || blocks.size() != size || drops[size_t(pc)] >= MaxDrops)
+		return false;
+
+	Assembler a(arena + used);
+	BlockCompiler compiler(a, memory, size, dispatch, exit);
+	const int64_t end = compiler.Compile(pc);
+	if (end == pc)
+		return false;
+
+	// start over when the arena fills up
+	if (used + a.bytes.size() > capacity)
+	{
+		Reset(size, code);
+		return false;
+	}
+
+	std::memcpy(arena + used, a.bytes.data(), a.bytes.size());
+	blocks[size_t(pc)] = arena + used;
+	used += a.bytes.size();
+
+	ranges.push_back({ pc, end });
+	for (int64_t address = pc; address < end; ++address)
+		code[address] |= CodeCompiled;
+	return true;
+}
+
+JitExit Jit::Run(JitContext& context) const
+{
+	typedef uint32_t (*Entry)(JitContext*);
+	return JitExit(reinterpret_cast<Entry>(entry)(&context));
+}
+
+void Jit::Invalidate(size_t address, uint8_t* code)
+{
+	const int64_t target = int64_t(address);
+	std::vector<Range> dropped;
+	for (size_t i = 0; i < ranges.size(); )
+	{
+		if (ranges[i].start <= target && target < ranges[i].end)
+		{
+			blocks[size_t(ranges[i].start)] = nullptr;
+			if (drops[size_t(ranges[i].start)] < MaxDrops)
+				++drops[size_t(ranges[i].start)];
+			dropped.push_back(ranges[i]);
+			ranges[i] = ranges.back();
+			ranges.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	for (const Range& range : dropped)
+	{
+		for (int64_t a = range.start; a < range.end; ++a)
+			code[a] &= ~CodeCompiled;
+	}
+
+	// words shared with blocks that are still valid stay marked
+	for (const Range& range : ranges)
+	{
+		for (const Range& other : dropped)
+		{
+			const int64_t begin = std::max(range.start, other.start);
+			const int64_t end = std::min(range.end, other.end);
+			for (int64_t a = begin; a < end; ++a)
+				code[a] |= CodeCompiled;
+		}
+	}
+}
+
+#endif
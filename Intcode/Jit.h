@@ -0,0 +1,134 @@
+#pragma once
+
+// x86-64 JIT compiler for 64-bit Intcode programs
+//
+// Basic blocks of the program image are compiled to native code in an
+// executable arena.  Blocks chain to each other through a table indexed by
+// program address and only return to the host when they reach an address
+// with no compiled block, an instruction they cannot run (input, output,
+// halt, or a memory access outside the flat image), or a write into an
+// address that holds compiled or decoded code.  The computer then interprets
+// one instruction, compiles a new block, or drops the stale code and resumes.
+// A block that has to be dropped more than a couple of times is not compiled
+// again, so code a program keeps rewriting is left to the interpreter.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// compile Intcode to native code where supported: the arena comes from mmap
+// and the entry stub follows the System V calling convention, so x86-64 Linux
+#ifndef INTCODE_JIT
+#if defined(__x86_64__) && defined(__linux__)
+#define INTCODE_JIT 1
+#else
+#define INTCODE_JIT 0
+#endif
+#endif
+
+// code map bits, one byte for each word of the program image
+enum CodeMap : uint8_t
+{
+	CodeDecoded = 1,	// part of an instruction in the decode cache
+	CodeCompiled = 2,	// part of an instruction in a compiled block
+};
+
+// state shared with compiled code
+struct JitContext
+{
+	int64_t* memory;
+	int64_t size;
+	int64_t pc;
+	int64_t base;
+	uint8_t* code;
+	void* const* blocks;
+	int64_t address;	// address written when leaving with JitExit::Modified
+};
+
+// reason compiled code returned to the host
+enum class JitExit : uint32_t
+{
+	Miss,		// no compiled block at pc
+	Interpret,	// the instruction at pc must be interpreted
+	Modified,	// a write hit code at address; execution resumes at pc
+};
+
+class Jit
+{
+public:
+	Jit();
+	~Jit();
+
+	// compiled code belongs to one program image, so copies start empty
+	Jit(const Jit&);
+	Jit& operator=(const Jit&);
+	Jit(Jit&& other);
+	Jit& operator=(Jit&& other);
+
+	// executable memory is available
+	bool Ready() const
+	{
+		return arena != nullptr;
+	}
+
+	// number of addresses covered by the block table
+	size_t Size() const
+	{
+		return blocks.size();
+	}
+
+	// compiled block for each address
+	void* const* Blocks() const
+	{
+		return blocks.data();
+	}
+
+	// drop all compiled code and size the block table for a program image,
+	// clearing the compiled marks in the code map if one is given
+	// (executable memory is allocated the first time the table is not empty)
+	void Reset(size_t size, uint8_t* code);
+
+	// size the block table for a larger program image, keeping the code
+	// compiled so far
+	void Grow(size_t size);
+
+	// compiling a block at pc has been given up on, so the instructions
+	// there are left to the interpreter
+	bool Rejected(int64_t pc) const;
+
+	// compile a block starting at pc, returning false if the first
+	// instruction cannot be compiled
+	bool Compile(const int64_t* memory, size_t size, int64_t pc, uint8_t* code);
+
+	// run compiled code until it needs the host
+	JitExit Run(JitContext& context) const;
+
+	// drop every compiled block that overlaps an address
+	void Invalidate(size_t address, uint8_t* code);
+
+private:
+	struct Range
+	{
+		int64_t start;
+		int64_t end;
+	};
+
+	uint8_t* arena = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+
+	// shared stubs at the start of the arena
+	size_t stubs = 0;
+	uint8_t* entry = nullptr;
+	uint8_t* exit = nullptr;
+	uint8_t* dispatch = nullptr;
+
+	// compiled block for each address, and the addresses each block covers
+	std::vector<void*> blocks;
+	std::vector<Range> ranges;
+
+	// number of times the block starting at each address has been dropped
+	std::vector<uint8_t> drops;
+
+	void EmitStubs();
+};
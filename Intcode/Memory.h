@@ -0,0 +1,291 @@
+#pragma once
+
+// Intcode program memory
+//
+// The loaded program image lives in a dense vector.  Addresses past the end
+// of the image are backed by 4 KiB pages that are allocated the first time
+// they are touched, found through a flat page table.  Addresses too large for
+// the page table (including negative ones) fall back to a sparse page map.
+// Untouched addresses read as zero, the same as std::map::operator[].
+//
+// Copies are copy-on-write: a copy shares the image and the pages with the
+// memory it was copied from, and the first write through either one copies
+// the image, or the page written to, before changing it.  The image is copied
+// as a whole so that it stays flat for the compiled code, while each page
+// beyond it is copied on its own.  Only operator[] and data() copy, so the
+// computer reads through Read and uses operator[] for its writes alone.
+// Copying a memory is safe from several threads at once, as long as nothing
+// is writing to it.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+
+template<typename Word>
+class PagedMemory
+{
+public:
+	using value_type = Word;
+
+	// words per page
+	static constexpr size_t PageSize = 4096 / sizeof(Word);
+
+	// largest page index held in the flat page table
+	static constexpr size_t MaxDirectPages = 1 << 16;
+
+	PagedMemory()
+		: image(std::make_shared<std::vector<Word>>())
+	{
+	}
+
+	PagedMemory(const PagedMemory& other)
+	{
+		Share(other);
+	}
+
+	PagedMemory(PagedMemory&& other)
+		: PagedMemory()
+	{
+		Swap(other);
+	}
+
+	PagedMemory& operator=(const PagedMemory& other)
+	{
+		if (this != &other)
+			Share(other);
+		return *this;
+	}
+
+	PagedMemory& operator=(PagedMemory&& other)
+	{
+		Swap(other);
+		return *this;
+	}
+
+	// append a word to the program image
+	void push_back(Word value)
+	{
+		Own();
+		image->push_back(value);
+		Owned();
+	}
+
+	// size of the program image
+	size_t size() const
+	{
+		return image->size();
+	}
+
+	// extend the program image with words moved out of the pages
+	void Grow(size_t size)
+	{
+		const size_t old = image->size();
+		if (size <= old)
+			return;
+		Own();
+		image->resize(size, Word(0));
+		const size_t last = std::min((size - 1) / PageSize + 1, pages.size());
+		for (size_t index = old / PageSize; index < last; ++index)
+		{
+			if (!pages[index])
+				continue;
+			const size_t first = index * PageSize;
+			const size_t begin = std::max(first, old);
+			const size_t end = std::min(first + PageSize, size);
+			std::copy(pages[index].get() + (begin - first), pages[index].get() + (end - first), image->begin() + begin);
+			if (end == first + PageSize)
+				pages[index].reset();
+		}
+		Owned();
+	}
+
+	// access a word for writing, allocating or copying its page if needed
+	Word& operator[](int64_t address)
+	{
+		if (uint64_t(address) < writable.load(std::memory_order_relaxed))
+			return words[size_t(address)];
+		const uint64_t index = uint64_t(address) / PageSize;
+		if (index < pages.size() && pages[size_t(index)].use_count() == 1)
+			return pages[size_t(index)].get()[uint64_t(address) % PageSize];
+		return WritableWord(uint64_t(address));
+	}
+
+	// read a word without allocating or copying
+	Word Read(int64_t address) const
+	{
+		if (uint64_t(address) < length)
+			return view[size_t(address)];
+		const Word* page = FindPage(uint64_t(address) / PageSize);
+		return page ? page[uint64_t(address) % PageSize] : Word(0);
+	}
+
+	// direct access to the program image
+	Word* data()
+	{
+		Own();
+		return words;
+	}
+	const Word* data() const
+	{
+		return image->data();
+	}
+
+	// call visit(address, words, count) for the words held in pages beyond
+	// the program image, in order of address
+	template<typename Visit>
+	void VisitPages(Visit visit) const
+	{
+		const size_t end = image->size();
+		for (size_t index = end / PageSize; index < pages.size(); ++index)
+		{
+			if (!pages[index])
+				continue;
+			const size_t first = std::max(index * PageSize, end);
+			visit(int64_t(first), pages[index].get() + (first - index * PageSize), index * PageSize + PageSize - first);
+		}
+
+		// the sparse pages, negative addresses first
+		std::vector<uint64_t> indices;
+		for (const auto& entry : sparse)
+			indices.push_back(entry.first);
+		std::sort(indices.begin(), indices.end(), [](uint64_t a, uint64_t b) { return int64_t(a * PageSize) < int64_t(b * PageSize); });
+		for (const uint64_t index : indices)
+			visit(int64_t(index * PageSize), sparse.find(index)->second.get(), PageSize);
+	}
+
+	// number of pages and images held in common with other copies
+	size_t SharedPages() const
+	{
+		size_t count = image.use_count() > 1 ? 1 : 0;
+		for (const Page& page : pages)
+		{
+			if (page && page.use_count() > 1)
+				++count;
+		}
+		for (const auto& entry : sparse)
+		{
+			if (entry.second.use_count() > 1)
+				++count;
+		}
+		return count;
+	}
+
+private:
+	// pages are shared between copies until written
+	using Page = std::shared_ptr<Word>;
+
+	// share the image and pages of another memory
+	void Share(const PagedMemory& other)
+	{
+		// the other memory has to copy the image before its next write too
+		if (other.writable.load(std::memory_order_relaxed))
+			other.writable.store(0, std::memory_order_relaxed);
+
+		image = other.image;
+		view = other.view;
+		length = other.length;
+		words = nullptr;
+		writable.store(0, std::memory_order_relaxed);
+		pages = other.pages;
+		sparse = other.sparse;
+	}
+
+	void Swap(PagedMemory& other)
+	{
+		std::swap(image, other.image);
+		std::swap(words, other.words);
+		std::swap(view, other.view);
+		std::swap(length, other.length);
+		const size_t mine = writable.load(std::memory_order_relaxed);
+		writable.store(other.writable.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		other.writable.store(mine, std::memory_order_relaxed);
+		pages.swap(other.pages);
+		sparse.swap(other.sparse);
+	}
+
+	// make the image private to this memory before writing it
+	void Own()
+	{
+		if (image.use_count() > 1)
+			image = std::make_shared<std::vector<Word>>(*image);
+		Owned();
+	}
+
+	// note that the image is private, after it has been copied or resized
+	void Owned()
+	{
+		words = image->data();
+		view = words;
+		length = image->size();
+		writable.store(image->size(), std::memory_order_relaxed);
+	}
+
+	// find, allocate or copy the word at an address that cannot be written in place
+	Word& WritableWord(uint64_t address)
+	{
+		if (address < image->size())
+		{
+			Own();
+			return words[size_t(address)];
+		}
+
+		const uint64_t index = address / PageSize;
+		Page* slot;
+		if (index < MaxDirectPages)
+		{
+			if (index >= pages.size())
+				pages.resize(size_t(index) + 1);
+			slot = &pages[size_t(index)];
+		}
+		else
+		{
+			slot = &sparse[index];
+		}
+		if (!*slot)
+			*slot = NewPage(nullptr);
+		else if (slot->use_count() > 1)
+			*slot = NewPage(slot->get());
+		return slot->get()[address % PageSize];
+	}
+
+	// find the page with a given index, if it has been allocated
+	const Word* FindPage(uint64_t index) const
+	{
+		if (index < pages.size())
+			return pages[size_t(index)].get();
+		if (index < MaxDirectPages)
+			return nullptr;
+		auto itor = sparse.find(index);
+		return itor != sparse.end() ? itor->second.get() : nullptr;
+	}
+
+	// allocate a page, zeroed or copied from another
+	static Page NewPage(const Word* source)
+	{
+		if (!source)
+			return Page(new Word[PageSize](), std::default_delete<Word[]>());
+		Page page(new Word[PageSize], std::default_delete<Word[]>());
+		std::copy(source, source + PageSize, page.get());
+		return page;
+	}
+
+	std::shared_ptr<std::vector<Word>> image;
+
+	// the image while this memory owns it
+	Word* words = nullptr;
+
+	// the image for reading, owned or not
+	const Word* view = nullptr;
+	size_t length = 0;
+
+	// number of image words that can be written in place: the image size
+	// while this memory owns the image, or 0 while it may be shared
+	mutable std::atomic<size_t> writable{ 0 };
+
+	std::vector<Page> pages;
+	std::unordered_map<uint64_t, Page> sparse;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+// Parsing Intcode programs from comma-separated text
+//
+// The text is read in fixed-size chunks into one buffer and parsed in place,
+// with the words appended straight to the memory backend, so nothing is
+// allocated apart from the backend's own growth.  A number cut off at the end
+// of a chunk is moved to the front of the buffer and finished with the next
+// one.  Numbers may be negative and surrounded by whitespace, including the
+// trailing newline; empty entries are skipped.  An entry that is not a number
+// that fits in a word reads as 0, so the words after it keep their addresses,
+// and ReadInput returns false.
+//
+// Numbers are parsed with std::from_chars where the standard library has it,
+// and by hand otherwise, with the same range checks.
+//
+// Included by Intcode.h.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <limits>
+
+// parse with std::from_chars where the library has it
+#ifndef INTCODE_FROM_CHARS
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#define INTCODE_FROM_CHARS 1
+#endif
+#endif
+#endif
+#endif
+#ifndef INTCODE_FROM_CHARS
+#define INTCODE_FROM_CHARS 0
+#endif
+
+#if INTCODE_FROM_CHARS
+#include <charconv>
+#endif
+
+// bytes read from the stream at a time
+constexpr size_t ParseChunk = 1 << 16;
+
+inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// parse the number starting at text, leaving text just past it; false if
+// there is no number there, or it does not fit in a word
+template<typename Word>
+bool ParseWord(const char*& text, const char* end, Word& value)
+{
+#if INTCODE_FROM_CHARS
+	const std::from_chars_result result = std::from_chars(text, end, value);
+	if (result.ec != std::errc())
+		return false;
+	text = result.ptr;
+	return true;
+#else
+	const char* p = text;
+	const bool negative = p != end && *p == '-';
+	if (negative)
+		++p;
+	if (p == end || unsigned(*p - '0') > 9)
+		return false;
+	const uint64_t limit = negative ? 0 - uint64_t(std::numeric_limits<Word>::min()) : uint64_t(std::numeric_limits<Word>::max());
+	uint64_t magnitude = 0;
+	for (; p != end && unsigned(*p - '0') <= 9; ++p)
+	{
+		const unsigned digit = unsigned(*p - '0');
+		if (magnitude > (limit - digit) / 10)
+			return false;
+		magnitude = magnitude * 10 + digit;
+	}
+	value = Word(negative ? 0 - magnitude : magnitude);
+	text = p;
+	return true;
+#endif
+}
+
+// parse the complete entries in [text, end), appending them to the memory;
+// false if one is not a number that fits in a word
+template<typename Memory>
+bool ParseEntries(Memory& output, const char* text, const char* end)
+{
+	using Word = typename Memory::value_type;
+	bool ok = true;
+	while (text != end)
+	{
+		while (text != end && IsSpace(*text))
+			++text;
+
+		if (text != end && *text != ',')
+		{
+			Word value;
+			bool good = ParseWord(text, end, value);
+			while (text != end && IsSpace(*text))
+				++text;
+			good = good && (text == end || *text == ',');
+
+			// a bad entry still takes up its address
+			output.push_back(good ? value : Word(0));
+			ok = ok && good;
+
+			while (text != end && *text != ',')
+				++text;
+		}
+		if (text != end)
+			++text;
+	}
+	return ok;
+}
+
+// read instructions from the input stream; false if an entry is not a
+// number that fits in a word
+template<typename Memory>
+bool ReadInput(Memory& output, std::istream& input)
+{
+	char buffer[ParseChunk];
+	size_t kept = 0;
+	bool ok = true;
+	for (;;)
+	{
+		input.read(buffer + kept, std::streamsize(ParseChunk - kept));
+		const size_t size = kept + size_t(input.gcount());
+		if (size == kept)
+		{
+			// the last entry has no comma after it
+			return ParseEntries(output, buffer, buffer + size) && ok;
+		}
+
+		// parse up to the last comma, keeping the rest for the next chunk
+		// (an entry that fills a whole chunk on its own is cut in two)
+		size_t complete = size;
+		while (complete > 0 && buffer[complete - 1] != ',')
+			--complete;
+		if (complete == 0)
+			complete = size;
+		ok = ParseEntries(output, buffer, buffer + complete) && ok;
+		kept = size - complete;
+		std::memmove(buffer, buffer + complete, kept);
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+// Lock-free single-producer, single-consumer queue for linking computers
+// that run on their own threads
+//
+// Values go through a power-of-two ring buffer whose read and write
+// positions are atomics owned by one side each, so a push or pop takes no
+// lock.  A consumer that finds the pipe empty spins for a while before
+// parking on a condition variable, which the producer only touches when the
+// consumer has said it is parked.  A producer that finds the pipe full
+// yields until there is room.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+template<typename Word>
+class Pipe
+{
+public:
+	// times an empty pipe is checked before the consumer parks
+	static constexpr int SpinCount = 1000;
+
+	explicit Pipe(size_t capacity = 1024)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+		buffer.resize(size);
+		mask = size - 1;
+	}
+
+	Pipe(const Pipe&) = delete;
+	Pipe& operator=(const Pipe&) = delete;
+
+	// add a value, returning false if the pipe is full
+	bool TryPush(Word value)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) > mask)
+			return false;
+		buffer[t & mask] = value;
+		tail.store(t + 1, std::memory_order_release);
+
+		// wake the consumer if it has parked
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (parked.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			wake.notify_one();
+		}
+		return true;
+	}
+
+	// add a value, waiting for room if the pipe is full
+	void Push(Word value)
+	{
+		while (!TryPush(value))
+			std::this_thread::yield();
+	}
+
+	// take a value, returning false if the pipe is empty
+	bool TryPop(Word& value)
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		value = buffer[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// take a value, waiting for one; returns false once the pipe is closed
+	// and empty
+	bool Pop(Word& value)
+	{
+		for (int spin = 0; spin < SpinCount; ++spin)
+		{
+			if (TryPop(value))
+				return true;
+		}
+
+		for (;;)
+		{
+			if (TryPop(value))
+				return true;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			parked.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			wake.wait(lock, [this]() { return !Empty() || closed.load(std::memory_order_acquire); });
+			parked.store(false, std::memory_order_relaxed);
+
+			if (Empty() && closed.load(std::memory_order_acquire))
+				return false;
+		}
+	}
+
+	// tell the consumer no more values are coming
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed.store(true, std::memory_order_release);
+		wake.notify_one();
+	}
+
+	bool Empty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	// bytes in a cache line
+	static constexpr size_t CacheLine = 64;
+
+	std::vector<Word> buffer;
+	size_t mask;
+
+	// read position, written by the consumer, and write position, written by
+	// the producer, padded onto separate cache lines
+	// (padding rather than alignas, which new only honours from C++17)
+	char padding1[CacheLine];
+	std::atomic<size_t> head{ 0 };
+	char padding2[CacheLine - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail{ 0 };
+	char padding3[CacheLine - sizeof(std::atomic<size_t>)];
+
+	// parking for an empty pipe
+	std::atomic<bool> parked{ false };
+	std::atomic<bool> closed{ false };
+	std::mutex mutex;
+	std::condition_variable wake;
+};
@@ -0,0 +1,154 @@
+#include "Intcode.h"
+
+#if INTCODE_PROFILE
+
+#include <algorithm>
+#include <iomanip>
+
+Profile::Profile()
+{
+	// the root of every call stack
+	nodes.push_back({ -1, 0, 0 });
+}
+
+void Profile::AdjustBase(int64_t pc, int64_t delta)
+{
+	if (delta > 0)
+	{
+		// entering a function
+		auto itor = children.find({ node, pc });
+		if (itor == children.end())
+		{
+			itor = children.insert({ { node, pc }, nodes.size() }).first;
+			nodes.push_back({ pc, node, 0 });
+		}
+		node = itor->second;
+	}
+	else if (delta < 0 && node != 0)
+	{
+		// returning from one
+		node = nodes[node].parent;
+	}
+}
+
+uint64_t Profile::Instructions() const
+{
+	uint64_t count = 0;
+	for (uint64_t n : opcodes)
+		count += n;
+	return count;
+}
+
+std::vector<std::pair<int64_t, uint64_t>> Profile::Counts::Sorted() const
+{
+	std::vector<std::pair<int64_t, uint64_t>> sorted;
+	for (size_t address = 0; address < near.size(); ++address)
+	{
+		if (near[address])
+			sorted.push_back({ int64_t(address), near[address] });
+	}
+	for (const auto& entry : far)
+		sorted.push_back(entry);
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<int64_t, uint64_t>& a, const std::pair<int64_t, uint64_t>& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		}
+	);
+	return sorted;
+}
+
+uint64_t Profile::Counts::Get(int64_t address) const
+{
+	if (uint64_t(address) < near.size())
+		return near[size_t(address)];
+	auto itor = far.find(address);
+	return itor != far.end() ? itor->second : 0;
+}
+
+void Profile::Report(std::ostream& out, size_t top) const
+{
+	const uint64_t total = Instructions();
+	auto percent = [total](uint64_t count)
+	{
+		return total ? 100.0 * double(count) / double(total) : 0.0;
+	};
+	auto name = [this](int64_t pc)
+	{
+		const char* text = uint64_t(pc) < code.size() ? OpcodeName(code[size_t(pc)]) : nullptr;
+		return text ? text : "?";
+	};
+
+	out << "instructions: " << total << std::endl;
+
+	out << std::endl << "by opcode:" << std::endl;
+	std::vector<std::pair<uint64_t, int>> byOpcode;
+	for (int opcode = 0; opcode < 100; ++opcode)
+	{
+		if (opcodes[opcode])
+			byOpcode.push_back({ opcodes[opcode], opcode });
+	}
+	std::sort(byOpcode.rbegin(), byOpcode.rend());
+	for (const auto& entry : byOpcode)
+	{
+		const char* text = OpcodeName(Opcode(entry.second));
+		out << std::setw(8) << (text ? text : "?") << std::setw(14) << entry.first << std::setw(8) << std::fixed << std::setprecision(2) << percent(entry.first) << "%" << std::endl;
+	}
+
+	out << std::endl << "hottest addresses:" << std::endl;
+	const auto hot = executed.Sorted();
+	for (size_t n = 0; n < hot.size() && n < top; ++n)
+	{
+		out << std::setw(8) << hot[n].first << std::setw(6) << name(hot[n].first) << std::setw(14) << hot[n].second << std::setw(8) << std::fixed << std::setprecision(2) << percent(hot[n].second) << "%" << std::endl;
+	}
+
+	out << std::endl << "branches (taken / not taken):" << std::endl;
+	std::vector<std::pair<uint64_t, int64_t>> branches;
+	for (const auto& entry : hot)
+	{
+		const uint64_t taken = jumps.Get(entry.first);
+		const uint64_t fallen = falls.Get(entry.first);
+		if (taken + fallen)
+			branches.push_back({ taken + fallen, entry.first });
+	}
+	std::stable_sort(branches.begin(), branches.end(), [](const std::pair<uint64_t, int64_t>& a, const std::pair<uint64_t, int64_t>& b)
+		{
+			return a.first > b.first;
+		}
+	);
+	for (size_t n = 0; n < branches.size() && n < top; ++n)
+	{
+		const int64_t pc = branches[n].second;
+		out << std::setw(8) << pc << std::setw(6) << name(pc) << std::setw(14) << jumps.Get(pc) << " /" << std::setw(14) << falls.Get(pc) << std::endl;
+	}
+
+	const char* titles[2] = { "most read:", "most written:" };
+	const Counts* data[2] = { &reads, &writes };
+	for (int d = 0; d < 2; ++d)
+	{
+		out << std::endl << titles[d] << std::endl;
+		const auto sorted = data[d]->Sorted();
+		for (size_t n = 0; n < sorted.size() && n < top; ++n)
+			out << std::setw(8) << sorted[n].first << std::setw(14) << sorted[n].second << std::endl;
+	}
+}
+
+void Profile::Folded(std::ostream& out) const
+{
+	for (size_t n = 0; n < nodes.size(); ++n)
+	{
+		if (!nodes[n].samples)
+			continue;
+
+		// walk up to the root, then write the frames outermost first
+		std::vector<int64_t> frames;
+		for (size_t at = n; at != 0; at = nodes[at].parent)
+			frames.push_back(nodes[at].function);
+
+		out << "main";
+		for (auto itor = frames.rbegin(); itor != frames.rend(); ++itor)
+			out << ";fn_" << *itor;
+		out << " " << nodes[n].samples << std::endl;
+	}
+}
+
+#endif
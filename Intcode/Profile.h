@@ -0,0 +1,122 @@
+#pragma once
+
+// Execution profile of an Intcode program
+//
+// With INTCODE_PROFILE set (for the library and the programs using it
+// alike), a computer given a Profile counts every instruction it runs by
+// address and by opcode, which way each conditional jump went, and how
+// often each address is read and written as data.  Profiled computers run
+// on the switch interpreter so every instruction is seen; without
+// INTCODE_PROFILE none of this is compiled in.
+//
+// Intcode has no call instruction, so calls are inferred from the relative
+// base: code generated for the days moves the relative base up by a frame
+// on entry to a function and back down before returning.  Each time the
+// base moves up, a frame named for that address is pushed onto a shadow
+// stack, and each time it moves down one is popped, giving call stacks for
+// folded-stack flame graphs.
+//
+// Included by Intcode.h when INTCODE_PROFILE is set.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <iostream>
+
+class Profile
+{
+public:
+	Profile();
+
+	void Instruction(int64_t pc, Opcode opcode)
+	{
+		++executed[pc];
+		++opcodes[int(opcode) < 100 ? int(opcode) : 0];
+		++nodes[node].samples;
+		if (uint64_t(pc) < uint64_t(Counts::MaxDirect))
+		{
+			if (size_t(pc) >= code.size())
+				code.resize(size_t(pc) + 1);
+			code[size_t(pc)] = opcode;
+		}
+	}
+
+	void Branch(int64_t pc, bool taken)
+	{
+		++(taken ? jumps : falls)[pc];
+	}
+
+	void Read(int64_t address)
+	{
+		++reads[address];
+	}
+
+	void Write(int64_t address)
+	{
+		++writes[address];
+	}
+
+	// the relative base moved by delta at pc
+	void AdjustBase(int64_t pc, int64_t delta);
+
+	// number of instructions counted
+	uint64_t Instructions() const;
+
+	// write the hottest addresses, opcodes, branches and data, top entries of each
+	void Report(std::ostream& out, size_t top = 20) const;
+
+	// write one line per call stack, "main;fn_123;fn_456 count", for flame graph tools
+	void Folded(std::ostream& out) const;
+
+private:
+	// counts by address, flat for small addresses
+	class Counts
+	{
+	public:
+		static constexpr int64_t MaxDirect = 1 << 20;
+
+		uint64_t& operator[](int64_t address)
+		{
+			if (uint64_t(address) < uint64_t(MaxDirect))
+			{
+				if (size_t(address) >= near.size())
+					near.resize(size_t(address) + 1);
+				return near[size_t(address)];
+			}
+			return far[address];
+		}
+
+		// nonzero counts, highest first
+		std::vector<std::pair<int64_t, uint64_t>> Sorted() const;
+
+		uint64_t Get(int64_t address) const;
+
+	private:
+		std::vector<uint64_t> near;
+		std::unordered_map<int64_t, uint64_t> far;
+	};
+
+	// a shadow call stack entry, shared between stacks with the same callers
+	struct Node
+	{
+		int64_t function;	// address of the base adjustment that entered it, or -1 for main
+		size_t parent;
+		uint64_t samples;	// instructions run with this as the innermost frame
+	};
+
+	Counts executed;
+	Counts jumps;
+	Counts falls;
+	Counts reads;
+	Counts writes;
+	uint64_t opcodes[100] = {};
+
+	std::vector<Node> nodes;
+	std::map<std::pair<size_t, int64_t>, size_t> children;
+	size_t node = 0;
+
+	// opcode last run at each address, for the report
+	std::vector<Opcode> code;
+};
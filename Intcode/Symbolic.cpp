@@ -0,0 +1,258 @@
+#include "Symbolic.h"
+
+Polynomial::Polynomial(int64_t value)
+{
+	if (value != 0)
+		terms[0] = value;
+}
+
+Polynomial Polynomial::Variable(int index)
+{
+	Polynomial result;
+	result.terms[Monomial(1) << (8 * index)] = 1;
+	return result;
+}
+
+Polynomial Polynomial::operator+(const Polynomial& other) const
+{
+	Polynomial result = *this;
+	for (const auto& term : other.terms)
+	{
+		const int64_t sum = (result.terms[term.first] += term.second);
+		if (sum == 0)
+			result.terms.erase(term.first);
+	}
+	return result;
+}
+
+Polynomial Polynomial::operator*(const Polynomial& other) const
+{
+	Polynomial result;
+	for (const auto& a : terms)
+	{
+		for (const auto& b : other.terms)
+		{
+			// adding the packed exponents multiplies the monomials
+			const int64_t sum = (result.terms[a.first + b.first] += a.second * b.second);
+			if (sum == 0)
+				result.terms.erase(a.first + b.first);
+		}
+	}
+	return result;
+}
+
+bool Polynomial::IsConstant() const
+{
+	return terms.empty() || (terms.size() == 1 && terms.begin()->first == 0);
+}
+
+int64_t Polynomial::Constant() const
+{
+	return Coefficient();
+}
+
+int Polynomial::Degree() const
+{
+	int degree = 0;
+	for (const auto& term : terms)
+	{
+		int total = 0;
+		for (int variable = 0; variable < MaxVariables; ++variable)
+			total += Exponent(term.first, variable);
+		degree = std::max(degree, total);
+	}
+	return degree;
+}
+
+int64_t Polynomial::Coefficient() const
+{
+	auto itor = terms.find(0);
+	return itor != terms.end() ? itor->second : 0;
+}
+
+int64_t Polynomial::Coefficient(int variable) const
+{
+	auto itor = terms.find(Monomial(1) << (8 * variable));
+	return itor != terms.end() ? itor->second : 0;
+}
+
+int64_t Polynomial::Evaluate(const std::vector<int64_t>& values) const
+{
+	int64_t result = 0;
+	for (const auto& term : terms)
+	{
+		int64_t product = term.second;
+		for (int variable = 0; variable < MaxVariables; ++variable)
+		{
+			for (int e = Exponent(term.first, variable); e > 0; --e)
+				product *= values[variable];
+		}
+		result += product;
+	}
+	return result;
+}
+
+void Polynomial::Print(std::ostream& out) const
+{
+	if (terms.empty())
+	{
+		out << 0;
+		return;
+	}
+	bool first = true;
+	for (const auto& term : terms)
+	{
+		if (!first)
+			out << " + ";
+		first = false;
+		out << term.second;
+		for (int variable = 0; variable < MaxVariables; ++variable)
+		{
+			for (int e = Exponent(term.first, variable); e > 0; --e)
+				out << "*v" << variable;
+		}
+	}
+}
+
+namespace
+{
+	// a value is only usable as a number if it is known and constant
+	bool Concrete(const Symbol& symbol, int64_t& value)
+	{
+		if (!symbol.known || !symbol.value.IsConstant())
+			return false;
+		value = symbol.value.Constant();
+		return true;
+	}
+
+	// a value that depends on the variables in a way that is not tracked
+	Symbol Unknown()
+	{
+		Symbol symbol;
+		symbol.known = false;
+		return symbol;
+	}
+
+	// keep a polynomial only while it is small enough to follow
+	// (exponents are a byte each, so products are checked before they are formed)
+	Symbol Known(const Polynomial& value)
+	{
+		if (value.Terms() > Polynomial::MaxTerms)
+			return Unknown();
+		Symbol symbol;
+		symbol.value = value;
+		return symbol;
+	}
+}
+
+State RunSymbolic(const std::vector<int64_t>& program, const std::vector<int64_t>& variables, std::vector<Symbol>& memory, uint64_t maxSteps)
+{
+	if (variables.size() > size_t(Polynomial::MaxVariables))
+		return State::Error;
+
+	memory.assign(program.size(), Symbol());
+	for (size_t address = 0; address < program.size(); ++address)
+		memory[address].value = Polynomial(program[address]);
+	for (size_t v = 0; v < variables.size(); ++v)
+	{
+		if (size_t(variables[v]) >= memory.size())
+			return State::Error;
+		memory[size_t(variables[v])].value = Polynomial::Variable(int(v));
+	}
+
+	const int64_t size = int64_t(memory.size());
+	int64_t pc = 0;
+	int64_t base = 0;
+
+	// the number at an address, failing if it is out of range or not a number
+	auto word = [&](int64_t address, int64_t& value)
+	{
+		return address >= 0 && address < size && Concrete(memory[size_t(address)], value);
+	};
+
+	for (uint64_t step = 0; step < maxSteps; ++step)
+	{
+		int64_t opcode;
+		if (!word(pc, opcode))
+			return State::Error;
+		const Instruction<int64_t> i = Decode(opcode);
+		const int length = InstructionLength(i.opcode);
+		if (pc + length > size)
+			return State::Error;
+
+		// read the parameters as symbols, following addresses where they are numbers
+		const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+		Symbol reads[2];
+		for (int p = 0; p < 2 && p + 1 < length; ++p)
+		{
+			const Symbol& param = memory[size_t(pc + 1 + p)];
+			int64_t address;
+			if (modes[p] == Mode::Immediate)
+				reads[p] = param;
+			else if (!Concrete(param, address))
+				reads[p] = Unknown();	// loaded through an address that depends on a variable
+			else if ((address += modes[p] == Mode::Relative ? base : 0) < 0 || address >= size)
+				return State::Error;
+			else
+				reads[p] = memory[size_t(address)];
+		}
+
+		// address written by the last parameter, which has to be a number
+		auto target = [&](int p, int64_t& address)
+		{
+			if (!Concrete(memory[size_t(pc + 1 + p)], address))
+				return false;
+			if (modes[p] == Mode::Relative)
+				address += base;
+			return address >= 0 && address < size;
+		};
+
+		int64_t address, a, b;
+		switch (i.opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+			if (!target(2, address))
+				return State::Error;
+			if (!reads[0].known || !reads[1].known || reads[0].value.Degree() + reads[1].value.Degree() > 255)
+				memory[size_t(address)] = Unknown();
+			else
+				memory[size_t(address)] = Known(i.opcode == Opcode::Add ? reads[0].value + reads[1].value : reads[0].value * reads[1].value);
+			pc += 4;
+			break;
+
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			if (!target(2, address))
+				return State::Error;
+			if (Concrete(reads[0], a) && Concrete(reads[1], b))
+				memory[size_t(address)] = Known(Polynomial(Evaluate(i.opcode, a, b)));
+			else
+				memory[size_t(address)] = Unknown();
+			pc += 4;
+			break;
+
+		case Opcode::JumpIfTrue:
+		case Opcode::JumpIfFalse:
+			if (!Concrete(reads[0], a) || !Concrete(reads[1], b))
+				return State::Error;
+			pc = (a != 0) == (i.opcode == Opcode::JumpIfTrue) ? b : pc + 3;
+			break;
+
+		case Opcode::RelativeBaseOffset:
+			if (!Concrete(reads[0], a))
+				return State::Error;
+			base += a;
+			pc += 2;
+			break;
+
+		case Opcode::Halt:
+			return State::Halt;
+
+		default:
+			// input, output and invalid opcodes
+			return State::Error;
+		}
+	}
+	return State::Error;
+}
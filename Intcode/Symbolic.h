@@ -0,0 +1,93 @@
+#pragma once
+
+// Symbolic execution of Intcode programs
+//
+// Some memory words are replaced by variables and the program is run once,
+// with each word holding a polynomial in the variables instead of a number.
+// This follows straight-line arithmetic such as the day 2 programs, giving
+// the final memory as a closed form in the variables.  Words that depend on
+// a variable in a way a polynomial cannot describe (a load through a
+// variable address, or a comparison of polynomials) become unknown, and the
+// run gives up with State::Error if control flow, an address written, or an
+// instruction word depends on a variable.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+
+#include "Intcode.h"
+
+// polynomial in up to MaxVariables variables with integer coefficients
+class Polynomial
+{
+public:
+	static constexpr int MaxVariables = 8;
+
+	// terms beyond this are not tracked, and the value becomes unknown
+	static constexpr size_t MaxTerms = 64;
+
+	Polynomial() = default;
+
+	// a constant
+	Polynomial(int64_t value);
+
+	// a single variable
+	static Polynomial Variable(int index);
+
+	Polynomial operator+(const Polynomial& other) const;
+	Polynomial operator*(const Polynomial& other) const;
+
+	bool IsConstant() const;
+	int64_t Constant() const;
+
+	// highest total degree of a term, 0 for a constant
+	int Degree() const;
+
+	// coefficient of the constant term, or of one variable on its own
+	int64_t Coefficient() const;
+	int64_t Coefficient(int variable) const;
+
+	// number of terms
+	size_t Terms() const
+	{
+		return terms.size();
+	}
+
+	// value for the given variable values
+	int64_t Evaluate(const std::vector<int64_t>& values) const;
+
+	// for example "3 + 2*v0*v1"
+	void Print(std::ostream& out) const;
+
+private:
+	// exponents of each variable, a byte apiece
+	using Monomial = uint64_t;
+
+	static int Exponent(Monomial monomial, int variable)
+	{
+		return int((monomial >> (8 * variable)) & 0xFF);
+	}
+
+	// coefficients by monomial, without zero coefficients
+	std::map<Monomial, int64_t> terms;
+};
+
+// a word of memory during symbolic execution
+struct Symbol
+{
+	bool known = true;
+	Polynomial value;
+};
+
+// run a program with the words at the given addresses replaced by
+// variables 0, 1, ... until it halts, leaving the final memory in memory;
+// returns State::Halt if it ran to the end, or State::Error if it reached
+// an instruction it cannot follow symbolically, or ran for maxSteps
+State RunSymbolic(const std::vector<int64_t>& program, const std::vector<int64_t>& variables, std::vector<Symbol>& memory, uint64_t maxSteps = 1 << 20);
+
+template<typename Word>
+State RunSymbolic(const std::vector<Word>& program, const std::vector<int64_t>& variables, std::vector<Symbol>& memory, uint64_t maxSteps = 1 << 20)
+{
+	return RunSymbolic(std::vector<int64_t>(program.begin(), program.end()), variables, memory, maxSteps);
+}
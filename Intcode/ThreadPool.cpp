@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t count)
+{
+	if (count == 0)
+		count = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t i = 0; i < count; ++i)
+		queues.emplace_back(new Queue);
+	for (size_t i = 0; i < count; ++i)
+		workers.emplace_back(&ThreadPool::Work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	start.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, const std::function<void(size_t, uint64_t)>& function)
+{
+	if (begin >= end)
+		return;
+	grain = std::max<uint64_t>(grain, 1);
+
+	// publish the job before dealing out its chunks, since a worker still
+	// finishing the last job may pick up a chunk as soon as it is queued
+	const uint64_t chunks = (end - begin + grain - 1) / grain;
+	body = &function;
+	pending = size_t(chunks);
+
+	// deal the chunks out round robin
+	for (uint64_t c = 0; c < chunks; ++c)
+	{
+		const uint64_t first = begin + c * grain;
+		Queue& queue = *queues[c % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.chunks.push_back({ first, std::min(first + grain, end) });
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	++generation;
+	start.notify_all();
+	done.wait(lock, [this]() { return pending == 0; });
+}
+
+void ThreadPool::Work(size_t worker)
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		Chunk chunk;
+		while (Take(worker, chunk))
+		{
+			const std::function<void(size_t, uint64_t)>& function = *body.load();
+			for (uint64_t index = chunk.begin; index < chunk.end; ++index)
+				function(worker, index);
+
+			if (--pending == 0)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done.notify_all();
+			}
+		}
+	}
+}
+
+// take a chunk from the back of this worker's queue, or steal one from the
+// front of another's
+bool ThreadPool::Take(size_t worker, Chunk& chunk)
+{
+	{
+		Queue& queue = *queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.chunks.empty())
+		{
+			chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+			return true;
+		}
+	}
+
+	for (size_t offset = 1; offset < queues.size(); ++offset)
+	{
+		Queue& queue = *queues[(worker + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.chunks.empty())
+		{
+			chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
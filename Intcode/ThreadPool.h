@@ -0,0 +1,70 @@
+#pragma once
+
+// Work-stealing thread pool for spreading independent runs across cores
+//
+// ParallelFor splits an index range into chunks and deals them out to the
+// workers' own queues.  Each worker takes chunks from the back of its own
+// queue and, once that is empty, steals from the front of the others, so
+// workers that draw cheap chunks help out the ones that drew expensive ones.
+// The calling thread waits until every chunk has run.
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+class ThreadPool
+{
+public:
+	// one worker per hardware thread when count is 0
+	explicit ThreadPool(size_t count = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t Workers() const
+	{
+		return workers.size();
+	}
+
+	// run body(worker, index) for every index in [begin, end), grain indices
+	// to a chunk, where worker is the index of the worker running it
+	void ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, const std::function<void(size_t, uint64_t)>& body);
+
+private:
+	struct Chunk
+	{
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// a worker's queue of chunks
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Chunk> chunks;
+	};
+
+	void Work(size_t worker);
+	bool Take(size_t worker, Chunk& chunk);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	// the current job: its body, a count of chunks still to run, and a
+	// generation number that tells workers a new job has started
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	std::atomic<const std::function<void(size_t, uint64_t)>*> body{ nullptr };
+	std::atomic<size_t> pending{ 0 };
+	uint64_t generation = 0;
+	bool stopping = false;
+};
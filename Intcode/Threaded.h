@@ -0,0 +1,285 @@
+#pragma once
+
+// Threaded-code dispatch for the Intcode computer
+//
+// Each decoded instruction is bound to a handler label specialised for its
+// opcode and parameter modes, and each handler jumps straight to the handler
+// of the next instruction with a computed goto, so plain instructions have
+// no mode branches at run time.  Superinstructions have one handler each and
+// still read their parameters through the mode switch, since specialising
+// them would take up to 27 handlers apiece.  This needs the GCC/Clang "labels
+// as values" extension; other compilers use the portable switch in
+// Computer::Execute.
+//
+// Included by Intcode.h when INTCODE_THREADED is set.
+
+// parameter access for each mode
+#define INTCODE_READ_P(x) Load(x)
+#define INTCODE_READ_I(x) (x)
+#define INTCODE_READ_R(x) Load(base + (x))
+#define INTCODE_WRITE_P(x) (x)
+#define INTCODE_WRITE_R(x) (base + (x))
+
+// dispatch the instruction at ip, binding it to a handler if needed
+#define INTCODE_NEXT() \
+	do \
+	{ \
+		if (size_t(ip) < count && table[size_t(ip)].handler) \
+		{ \
+			i = &table[size_t(ip)]; \
+			goto *i->handler; \
+		} \
+		goto bind; \
+	} \
+	while (0)
+
+// instructions with two inputs and one output
+#define INTCODE_BINARY(name, op, a, b, c) \
+	name##_##a##b##c: \
+		Store(INTCODE_WRITE_##c(i->param3), INTCODE_READ_##a(i->param1) op INTCODE_READ_##b(i->param2)); \
+		ip += 4; \
+		INTCODE_NEXT();
+#define INTCODE_BINARY_C(name, op, a, b) \
+	INTCODE_BINARY(name, op, a, b, P) \
+	INTCODE_BINARY(name, op, a, b, R)
+#define INTCODE_BINARY_BC(name, op, a) \
+	INTCODE_BINARY_C(name, op, a, P) \
+	INTCODE_BINARY_C(name, op, a, I) \
+	INTCODE_BINARY_C(name, op, a, R)
+#define INTCODE_BINARY_ALL(name, op) \
+	INTCODE_BINARY_BC(name, op, P) \
+	INTCODE_BINARY_BC(name, op, I) \
+	INTCODE_BINARY_BC(name, op, R)
+
+// conditional jumps
+#define INTCODE_JUMP(name, op, a, b) \
+	name##_##a##b: \
+		ip = INTCODE_READ_##a(i->param1) op 0 ? INTCODE_READ_##b(i->param2) : ip + 3; \
+		INTCODE_NEXT();
+#define INTCODE_JUMP_B(name, op, a) \
+	INTCODE_JUMP(name, op, a, P) \
+	INTCODE_JUMP(name, op, a, I) \
+	INTCODE_JUMP(name, op, a, R)
+#define INTCODE_JUMP_ALL(name, op) \
+	INTCODE_JUMP_B(name, op, P) \
+	INTCODE_JUMP_B(name, op, I) \
+	INTCODE_JUMP_B(name, op, R)
+
+// handler table entries, indexed by mode1 * 9 + mode2 * 3 + mode3
+// (immediate mode outputs behave as position mode)
+#define INTCODE_TABLE_BINARY_C(name, a, b) &&name##_##a##b##P, &&name##_##a##b##P, &&name##_##a##b##R
+#define INTCODE_TABLE_BINARY_BC(name, a) INTCODE_TABLE_BINARY_C(name, a, P), INTCODE_TABLE_BINARY_C(name, a, I), INTCODE_TABLE_BINARY_C(name, a, R)
+#define INTCODE_TABLE_BINARY(name) INTCODE_TABLE_BINARY_BC(name, P), INTCODE_TABLE_BINARY_BC(name, I), INTCODE_TABLE_BINARY_BC(name, R)
+#define INTCODE_TABLE_JUMP_B(name, a, b) &&name##_##a##b, &&name##_##a##b, &&name##_##a##b
+#define INTCODE_TABLE_JUMP_A(name, a) INTCODE_TABLE_JUMP_B(name, a, P), INTCODE_TABLE_JUMP_B(name, a, I), INTCODE_TABLE_JUMP_B(name, a, R)
+#define INTCODE_TABLE_JUMP(name) INTCODE_TABLE_JUMP_A(name, P), INTCODE_TABLE_JUMP_A(name, I), INTCODE_TABLE_JUMP_A(name, R)
+#define INTCODE_TABLE_UNARY_A(label) &&label, &&label, &&label, &&label, &&label, &&label, &&label, &&label, &&label
+#define INTCODE_TABLE_UNARY(name, p, i, r) INTCODE_TABLE_UNARY_A(name##_##p), INTCODE_TABLE_UNARY_A(name##_##i), INTCODE_TABLE_UNARY_A(name##_##r)
+#define INTCODE_TABLE_NONE(label) INTCODE_TABLE_UNARY_A(label), INTCODE_TABLE_UNARY_A(label), INTCODE_TABLE_UNARY_A(label)
+
+// handler slot for an opcode or superinstruction
+inline int HandlerSlot(Opcode opcode, Fusion fusion)
+{
+	if (fusion != Fusion::None)
+		return 11 + int(fusion) - int(Fusion::Set);
+	return opcode == Opcode::Halt ? 10 : int(opcode);
+}
+
+template<typename Word, typename Memory>
+int Computer<Word, Memory>::HandlerIndex(const Instruction<Word>& instruction)
+{
+	return HandlerSlot(instruction.opcode, instruction.fusion) * 27 + int(instruction.mode1) * 9 + int(instruction.mode2) * 3 + int(instruction.mode3);
+}
+
+// run decoded instructions with threaded dispatch until the program halts,
+// fails, needs input, or has produced the given number of outputs
+template<typename Word, typename Memory>
+State Computer<Word, Memory>::Threaded(size_t outputs)
+{
+	static void* const handlers[(11 + FusionCount) * 27] =
+	{
+		INTCODE_TABLE_NONE(Fault),
+		INTCODE_TABLE_BINARY(Add),
+		INTCODE_TABLE_BINARY(Multiply),
+		INTCODE_TABLE_UNARY(Input, P, P, R),
+		INTCODE_TABLE_UNARY(Output, P, I, R),
+		INTCODE_TABLE_JUMP(JumpIfTrue),
+		INTCODE_TABLE_JUMP(JumpIfFalse),
+		INTCODE_TABLE_BINARY(LessThan),
+		INTCODE_TABLE_BINARY(Equals),
+		INTCODE_TABLE_UNARY(RelativeBaseOffset, P, I, R),
+		INTCODE_TABLE_NONE(Halt),
+		INTCODE_TABLE_NONE(Set),
+		INTCODE_TABLE_NONE(Goto),
+		INTCODE_TABLE_NONE(TestJumpIfTrue),
+		INTCODE_TABLE_NONE(TestJumpIfFalse),
+		INTCODE_TABLE_NONE(AdjustJumpIfTrue),
+		INTCODE_TABLE_NONE(AdjustJumpIfFalse),
+	};
+
+	if (decoded.size() != memory.size())
+	{
+		decoded.assign(memory.size(), Instruction<Word>());
+		code.assign(memory.size(), 0);
+	}
+
+	// the cache does not move while running
+	Instruction<Word>* const table = decoded.data();
+	const size_t count = decoded.size();
+
+	Word ip = pc;
+	Word base = relativebase;
+	Instruction<Word>* i;
+	Word value;
+	State state;
+
+	INTCODE_NEXT();
+
+bind:
+	i = &Fetch(ip);
+	i->handler = handlers[HandlerIndex(*i)];
+	goto *i->handler;
+
+	INTCODE_BINARY_ALL(Add, +)
+	INTCODE_BINARY_ALL(Multiply, *)
+	INTCODE_BINARY_ALL(LessThan, <)
+	INTCODE_BINARY_ALL(Equals, ==)
+	INTCODE_JUMP_ALL(JumpIfTrue, !=)
+	INTCODE_JUMP_ALL(JumpIfFalse, ==)
+
+Input_P:
+	if (input.empty())
+	{
+		state = State::Wait;
+		goto done;
+	}
+	Store(INTCODE_WRITE_P(i->param1), input.Pop());
+	ip += 2;
+	INTCODE_NEXT();
+
+Input_R:
+	if (input.empty())
+	{
+		state = State::Wait;
+		goto done;
+	}
+	Store(INTCODE_WRITE_R(i->param1), input.Pop());
+	ip += 2;
+	INTCODE_NEXT();
+
+Output_P:
+	output.push_back(INTCODE_READ_P(i->param1));
+	goto output_done;
+
+Output_I:
+	output.push_back(INTCODE_READ_I(i->param1));
+	goto output_done;
+
+Output_R:
+	output.push_back(INTCODE_READ_R(i->param1));
+	goto output_done;
+
+output_done:
+	ip += 2;
+	if (--outputs == 0)
+	{
+		state = State::Output;
+		goto done;
+	}
+	INTCODE_NEXT();
+
+RelativeBaseOffset_P:
+	base += INTCODE_READ_P(i->param1);
+	ip += 2;
+	INTCODE_NEXT();
+
+RelativeBaseOffset_I:
+	base += INTCODE_READ_I(i->param1);
+	ip += 2;
+	INTCODE_NEXT();
+
+RelativeBaseOffset_R:
+	base += INTCODE_READ_R(i->param1);
+	ip += 2;
+	INTCODE_NEXT();
+
+	// superinstructions read their parameters through the mode switch
+Set:
+	++fusions[int(Fusion::Set) - int(Fusion::Set)];
+	Store(Address(i->mode3, i->param3, base), i->param1);
+	ip += 4;
+	INTCODE_NEXT();
+
+Goto:
+	++fusions[int(Fusion::Goto) - int(Fusion::Set)];
+	ip = Read(i->mode2, i->param2, base);
+	INTCODE_NEXT();
+
+TestJumpIfTrue:
+	++fusions[int(Fusion::TestJumpIfTrue) - int(Fusion::Set)];
+	value = Evaluate(i->opcode, Read(i->mode1, i->param1, base), Read(i->mode2, i->param2, base));
+	Store(Address(i->mode3, i->param3, base), value);
+	if (i->span == 0)
+		ip += 4;	// the store changed this instruction or the jump
+	else
+		ip = value != 0 ? Read(i->mode4, i->param4, base) : ip + 7;
+	INTCODE_NEXT();
+
+TestJumpIfFalse:
+	++fusions[int(Fusion::TestJumpIfFalse) - int(Fusion::Set)];
+	value = Evaluate(i->opcode, Read(i->mode1, i->param1, base), Read(i->mode2, i->param2, base));
+	Store(Address(i->mode3, i->param3, base), value);
+	if (i->span == 0)
+		ip += 4;	// the store changed this instruction or the jump
+	else
+		ip = value == 0 ? Read(i->mode4, i->param4, base) : ip + 7;
+	INTCODE_NEXT();
+
+AdjustJumpIfTrue:
+	++fusions[int(Fusion::AdjustJumpIfTrue) - int(Fusion::Set)];
+	base += i->param1;
+	ip = Read(i->mode2, i->param2, base) != 0 ? Read(i->mode3, i->param3, base) : ip + 5;
+	INTCODE_NEXT();
+
+AdjustJumpIfFalse:
+	++fusions[int(Fusion::AdjustJumpIfFalse) - int(Fusion::Set)];
+	base += i->param1;
+	ip = Read(i->mode2, i->param2, base) == 0 ? Read(i->mode3, i->param3, base) : ip + 5;
+	INTCODE_NEXT();
+
+Halt:
+	state = State::Halt;
+	goto done;
+
+Fault:
+	state = State::Error;
+	goto done;
+
+done:
+	pc = ip;
+	relativebase = base;
+	return state;
+}
+
+#undef INTCODE_READ_P
+#undef INTCODE_READ_I
+#undef INTCODE_READ_R
+#undef INTCODE_WRITE_P
+#undef INTCODE_WRITE_R
+#undef INTCODE_NEXT
+#undef INTCODE_BINARY
+#undef INTCODE_BINARY_C
+#undef INTCODE_BINARY_BC
+#undef INTCODE_BINARY_ALL
+#undef INTCODE_JUMP
+#undef INTCODE_JUMP_B
+#undef INTCODE_JUMP_ALL
+#undef INTCODE_TABLE_BINARY_C
+#undef INTCODE_TABLE_BINARY_BC
+#undef INTCODE_TABLE_BINARY
+#undef INTCODE_TABLE_JUMP_B
+#undef INTCODE_TABLE_JUMP_A
+#undef INTCODE_TABLE_JUMP
+#undef INTCODE_TABLE_UNARY_A
+#undef INTCODE_TABLE_UNARY
+#undef INTCODE_TABLE_NONE
@@ -0,0 +1,264 @@
+#include "Intcode.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char Magic[8] = { 'I', 'N', 'T', 'C', 'T', 'R', 'C', '\0' };
+	const uint32_t Version = 1;
+
+	// number of operands recorded for an opcode byte, or -1 if it is not one
+	int OperandCount(uint8_t opcode)
+	{
+		switch (opcode)
+		{
+		case uint8_t(Opcode::Add):
+		case uint8_t(Opcode::Multiply):
+		case uint8_t(Opcode::LessThan):
+		case uint8_t(Opcode::Equals):
+			return 3;
+		case uint8_t(Opcode::Input):
+		case uint8_t(Opcode::JumpIfTrue):
+		case uint8_t(Opcode::JumpIfFalse):
+			return 2;
+		case uint8_t(Opcode::Output):
+		case uint8_t(Opcode::RelativeBaseOffset):
+		case 0xFF:
+			return 1;
+		case uint8_t(Opcode::Halt):
+			return 0;
+		default:
+			return -1;
+		}
+	}
+}
+
+Trace::Trace(size_t size)
+{
+	Map(size);
+}
+
+Trace::Trace(const std::string& path, size_t size)
+{
+	file = true;
+#ifdef _WIN32
+	handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		handle = nullptr;
+		return;
+	}
+#else
+	handle = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (handle < 0)
+		return;
+#endif
+	Map(size);
+}
+
+Trace::~Trace()
+{
+	Flush();
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (handle)
+		CloseHandle(handle);
+#else
+	if (data)
+		munmap(data, size);
+	if (handle >= 0)
+		close(handle);
+#endif
+}
+
+// map a header block and the ring after it
+void Trace::Map(size_t ring)
+{
+	const uint64_t blocks = std::max<size_t>(ring / BlockSize, 1);
+	size = size_t(blocks + 1) * BlockSize;
+
+	void* memory = nullptr;
+#ifdef _WIN32
+	mapping = CreateFileMappingA(file ? handle : INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), nullptr);
+	if (mapping)
+		memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+	if (file)
+	{
+		if (ftruncate(handle, off_t(size)) == 0)
+			memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+	}
+	else
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+		memory = nullptr;
+#endif
+	if (!memory)
+	{
+		size = 0;
+		return;
+	}
+
+	data = static_cast<uint8_t*>(memory);
+	Header header = {};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.blockSize = uint32_t(BlockSize);
+	header.blocks = blocks;
+	std::memcpy(data, &header, sizeof(header));
+}
+
+// start writing the next block of the ring, over the oldest one once it wraps
+void Trace::NextBlock()
+{
+	const size_t blocks = size / BlockSize - 1;
+	uint8_t* start = data + (1 + size_t(sequence % blocks)) * BlockSize;
+
+	// a zero opcode ends the block, so clear out the records it held
+	std::memset(start, 0, BlockSize);
+	BlockHeader header = { ++sequence, records, next, 0 };
+	std::memcpy(start, &header, sizeof(header));
+
+	cursor = start + sizeof(header);
+	end = start + BlockSize;
+}
+
+std::vector<TraceEntry> Trace::Last(size_t count) const
+{
+	std::vector<TraceEntry> entries;
+	if (data)
+		DecodeTrace(data, size, count, entries);
+	return entries;
+}
+
+void Trace::Flush()
+{
+	if (!data || !file)
+		return;
+#ifdef _WIN32
+	FlushViewOfFile(data, 0);
+#else
+	msync(data, size, MS_ASYNC);
+#endif
+}
+
+bool DecodeTrace(const uint8_t* data, size_t size, size_t last, std::vector<TraceEntry>& entries)
+{
+	entries.clear();
+
+	Trace::Header header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.blockSize < sizeof(Trace::BlockHeader))
+		return false;
+	if (header.blocks == 0 || (header.blocks + 1) > size / header.blockSize)
+		return false;
+
+	// the blocks in the order they were written
+	std::vector<std::pair<uint64_t, size_t>> order;
+	for (size_t b = 0; b < header.blocks; ++b)
+	{
+		Trace::BlockHeader block;
+		std::memcpy(&block, data + (1 + b) * header.blockSize, sizeof(block));
+		if (block.sequence)
+			order.push_back({ block.sequence, b });
+	}
+	std::sort(order.begin(), order.end());
+
+	// decode from the newest block back until there are enough records
+	std::vector<TraceEntry> decoded;
+	for (auto itor = order.rbegin(); itor != order.rend() && entries.size() < last; ++itor)
+	{
+		const uint8_t* in = data + (1 + itor->second) * header.blockSize;
+		const uint8_t* end = in + header.blockSize;
+		Trace::BlockHeader block;
+		std::memcpy(&block, in, sizeof(block));
+		in += sizeof(block);
+
+		decoded.clear();
+		int64_t next = block.next;
+		while (in < end && *in != 0)
+		{
+			const uint8_t opcode = *in++;
+			const int count = OperandCount(opcode);
+			if (count < 0)
+				break;
+
+			TraceEntry entry = {};
+			entry.index = block.first + decoded.size();
+			entry.opcode = opcode == 0xFF ? Opcode(0) : Opcode(opcode);
+			entry.count = count;
+			int64_t delta;
+			bool complete = Varint::GetSigned(in, end, delta);
+			for (int n = 0; complete && n < count; ++n)
+				complete = Varint::GetSigned(in, end, entry.operands[n]);
+			if (!complete)
+				break;	// cut off while it was written
+
+			entry.pc = next + delta;
+			next = entry.pc + InstructionLength(Opcode(opcode));
+			decoded.push_back(entry);
+		}
+
+		const size_t take = std::min(decoded.size(), last - entries.size());
+		entries.insert(entries.begin(), decoded.end() - take, decoded.end());
+	}
+	return true;
+}
+
+bool ReadTrace(const std::string& path, size_t last, std::vector<TraceEntry>& entries)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	return DecodeTrace(data.data(), data.size(), last, entries);
+}
+
+void WriteTrace(std::ostream& out, const std::vector<TraceEntry>& entries)
+{
+	for (const TraceEntry& entry : entries)
+	{
+		const int64_t* v = entry.operands;
+		const char* name = OpcodeName(entry.opcode);
+		out << std::setw(12) << entry.index << std::setw(8) << entry.pc << "  " << std::left << std::setw(6) << (name ? name : "fault") << std::right;
+		switch (entry.opcode)
+		{
+		case Opcode::Add:
+		case Opcode::Multiply:
+		case Opcode::LessThan:
+		case Opcode::Equals:
+			out << v[0] << ", " << v[1] << " -> [" << v[2] << "]";
+			break;
+		case Opcode::Input:
+			out << "[" << v[0] << "] <- " << v[1];
+			break;
+		case Opcode::JumpIfTrue:
+		case Opcode::JumpIfFalse:
+			out << v[0] << ", " << v[1] << (((v[0] != 0) == (entry.opcode == Opcode::JumpIfTrue)) ? " (taken)" : "");
+			break;
+		case Opcode::Halt:
+			break;
+		default:
+			out << v[0];
+			break;
+		}
+		out << std::endl;
+	}
+}
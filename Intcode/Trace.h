@@ -0,0 +1,173 @@
+#pragma once
+
+// Compact binary execution trace of an Intcode program
+//
+// A computer given a Trace runs on a tracing interpreter that appends one
+// record per instruction to a ring buffer: the opcode, the difference between
+// its address and the address the previous instruction fell through to, and
+// the operand values it used, all as variable-length integers.  Straight-line
+// code costs a byte for the address, so a record is usually a few bytes.
+//
+// The ring is split into blocks.  Each starts with a header giving its place
+// in the trace and the address its first record is relative to, and records
+// never cross a block boundary, so once the ring has wrapped the decoder can
+// still start at the oldest whole block.  Given a path, the ring is a mapped
+// file, which survives the process that wrote it.  DecodeTrace and ReadTrace
+// turn a trace back into instructions, and the TraceDump tool prints the
+// last of them.
+//
+// The tracing interpreter is Computer::Traced, which also runs while an
+// InputLog is recording.  It runs one instruction at a time through a switch
+// and does not fuse instructions: superinstructions fused before the trace
+// was attached are decoded again as their parts.  Whatever Dispatch the
+// computer asks for, threaded dispatch and compiled code are not used while
+// a trace is attached, so a traced run costs more than the records alone.
+// On day 9 an untraced run takes about 5 ns an instruction, recording about
+// 9 and tracing about 11.  Recording from the threaded handlers instead was
+// measured slower still (about 16), as each handler then carries the record.
+//
+// Included by Intcode.h.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "Varint.h"
+
+// one decoded trace record
+struct TraceEntry
+{
+	uint64_t index;			// instructions traced before this one
+	int64_t pc;
+	Opcode opcode;			// Opcode(0) for a word that is not an instruction
+	int count;				// number of operands
+	int64_t operands[3];	// operand values, see Trace::Record
+};
+
+class Trace
+{
+public:
+	// size of a block in bytes
+	static constexpr size_t BlockSize = 4096;
+
+	// a ring of the given size in memory
+	explicit Trace(size_t size = 1 << 20);
+
+	// a ring of the given size in a file, which is created or overwritten
+	Trace(const std::string& path, size_t size);
+
+	~Trace();
+
+	Trace(const Trace&) = delete;
+	Trace& operator=(const Trace&) = delete;
+
+	// the ring was mapped
+	bool Ready() const
+	{
+		return data != nullptr;
+	}
+
+	// record an instruction and the values it used:
+	// add, multiply, less than, equals: both inputs, then the address written
+	// input: the address written, then the value read
+	// output: the value written
+	// jumps: the condition, then the target
+	// relative base offset: the offset
+	void Record(int64_t pc, Opcode opcode, const int64_t* operands, int count)
+	{
+		if (!data)
+			return;
+		if (size_t(end - cursor) < MaxRecord)
+			NextBlock();
+
+		uint8_t* out = cursor;
+		*out++ = uint8_t(opcode);
+		out = Varint::PutSigned(out, pc - next);
+		for (int n = 0; n < count; ++n)
+			out = Varint::PutSigned(out, operands[n]);
+		cursor = out;
+
+		next = pc + InstructionLength(opcode);
+		++records;
+	}
+
+	// record a word the computer failed to run as an instruction
+	void Fault(int64_t pc, int64_t word)
+	{
+		const int64_t operands[1] = { word };
+		Record(pc, Opcode(FaultMarker), operands, 1);
+	}
+
+	// instructions recorded
+	uint64_t Records() const
+	{
+		return records;
+	}
+
+	// the last instructions recorded, oldest first
+	std::vector<TraceEntry> Last(size_t count) const;
+
+	// write buffered changes to the file, if there is one
+	void Flush();
+
+private:
+	friend bool DecodeTrace(const uint8_t* data, size_t size, size_t last, std::vector<TraceEntry>& entries);
+
+	// opcode byte of a fault record (0 ends a block)
+	static constexpr uint8_t FaultMarker = 0xFF;
+
+	// opcode, address and three operands at ten bytes each
+	static constexpr size_t MaxRecord = 1 + 4 * 10;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t blockSize;
+		uint64_t blocks;
+		uint64_t reserved;
+	};
+
+	struct BlockHeader
+	{
+		uint64_t sequence;	// 1 for the first block written, 0 if unused
+		uint64_t first;		// index of the first record
+		int64_t next;		// address the first record is relative to
+		uint64_t reserved;
+	};
+
+	void Map(size_t size);
+	void NextBlock();
+
+	// the mapping, and where it came from
+	uint8_t* data = nullptr;
+	size_t size = 0;
+	bool file = false;
+#ifdef _WIN32
+	void* handle = nullptr;
+	void* mapping = nullptr;
+#else
+	int handle = -1;
+#endif
+
+	// the block being written
+	uint8_t* cursor = nullptr;
+	uint8_t* end = nullptr;
+	uint64_t block = 0;
+	uint64_t sequence = 0;
+
+	int64_t next = 0;
+	uint64_t records = 0;
+};
+
+// decode a trace image, keeping the last records; false if it is not a trace
+bool DecodeTrace(const uint8_t* data, size_t size, size_t last, std::vector<TraceEntry>& entries);
+
+// read and decode a trace file
+bool ReadTrace(const std::string& path, size_t last, std::vector<TraceEntry>& entries);
+
+// write decoded records one to a line
+void WriteTrace(std::ostream& out, const std::vector<TraceEntry>& entries);
@@ -0,0 +1,71 @@
+#pragma once
+
+// Runtime support for Intcode programs transpiled to C++ by Transpile
+//
+// A transpiled program is a function
+//
+//     State Name(Computer<int64_t>& computer, const IntcodeIO& io);
+//
+// that runs the program held in the computer's memory as native code from
+// computer.pc, with input and output going through callbacks.  It falls back
+// to the computer's interpreter for jumps to addresses it has no code for,
+// and for the rest of the run once the program has overwritten its own code.
+
+#include "Intcode.h"
+
+// input and output callbacks
+struct IntcodeIO
+{
+	// get the next input value, or return false to stop and wait for one
+	bool (*input)(void* context, int64_t& value);
+
+	// take an output value, or return false to stop after it
+	bool (*output)(void* context, int64_t value);
+
+	void* context;
+};
+
+// callbacks that use the computer's own input and output queues, so a
+// transpiled program can stand in for RunUntil
+inline IntcodeIO QueueIO(Computer<int64_t>& computer)
+{
+	IntcodeIO io;
+	io.input = [](void* context, int64_t& value)
+	{
+		Channel<int64_t>& input = static_cast<Computer<int64_t>*>(context)->input;
+		if (input.empty())
+			return false;
+		value = input.Pop();
+		return true;
+	};
+	io.output = [](void* context, int64_t value)
+	{
+		static_cast<Computer<int64_t>*>(context)->output.push_back(value);
+		return true;
+	};
+	io.context = &computer;
+	return io;
+}
+
+// interpret one instruction, passing input and output through the callbacks
+inline State StepIO(Computer<int64_t>& computer, const IntcodeIO& io)
+{
+	if (computer.input.empty() && Decode(computer.memory.Read(computer.pc)).opcode == Opcode::Input)
+	{
+		int64_t value;
+		if (!io.input(io.context, value))
+			return State::Wait;
+		computer.input.push_back(value);
+	}
+
+	const size_t pending = computer.output.size();
+	const State state = computer.Step();
+	if (computer.output.size() > pending)
+	{
+		const int64_t value = computer.output.back();
+		computer.output.pop_back();
+		if (!io.output(io.context, value))
+			return State::Output;
+	}
+	return state;
+}
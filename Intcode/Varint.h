@@ -0,0 +1,104 @@
+#pragma once
+
+// Variable-length integers for the binary files the Intcode library writes
+//
+// Values take seven bits to a byte, low bits first, with the top bit set on
+// every byte but the last, so a 64-bit value takes at most ten bytes.  Signed
+// values are zigzag encoded first, so small negative values stay short.
+// Traces, input logs and checkpoints all use them.
+//
+// Included by Trace.h.
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace Varint
+{
+	inline uint64_t Zigzag(int64_t value)
+	{
+		return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+	}
+
+	inline int64_t Unzigzag(uint64_t bits)
+	{
+		return int64_t(bits >> 1) ^ -int64_t(bits & 1);
+	}
+
+	// write to a buffer with room for ten bytes, returning the end
+	inline uint8_t* Put(uint8_t* out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			*out++ = uint8_t(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = uint8_t(value);
+		return out;
+	}
+
+	inline uint8_t* PutSigned(uint8_t* out, int64_t value)
+	{
+		return Put(out, Zigzag(value));
+	}
+
+	inline void Put(std::ostream& out, uint64_t value)
+	{
+		uint8_t bytes[10];
+		out.write(reinterpret_cast<const char*>(bytes), Put(bytes, value) - bytes);
+	}
+
+	inline void PutSigned(std::ostream& out, int64_t value)
+	{
+		Put(out, Zigzag(value));
+	}
+
+	// read from a buffer, failing at its end or on a value too long to be one
+	inline bool Get(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (in == end)
+				return false;
+			const uint8_t byte = *in++;
+			value |= uint64_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	inline bool GetSigned(const uint8_t*& in, const uint8_t* end, int64_t& value)
+	{
+		uint64_t bits;
+		if (!Get(in, end, bits))
+			return false;
+		value = Unzigzag(bits);
+		return true;
+	}
+
+	inline bool Get(std::istream& in, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			const int byte = in.get();
+			if (byte == std::char_traits<char>::eof())
+				return false;
+			value |= uint64_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	inline bool GetSigned(std::istream& in, int64_t& value)
+	{
+		uint64_t bits;
+		if (!Get(in, bits))
+			return false;
+		value = Unzigzag(bits);
+		return true;
+	}
+}
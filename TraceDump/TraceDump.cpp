@@ -0,0 +1,40 @@
+// Intcode trace decoder
+//
+// Reads a trace file written by a computer given a Trace (see
+// Intcode/Trace.h) and prints the last instructions it recorded, oldest
+// first, one to a line: the instruction's index in the run, its address,
+// the opcode and the operand values it used.  The last line is the halt or
+// fault that ended the run, if it ended.
+//
+// usage: TraceDump trace [count]
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "../Intcode/Intcode.h"
+
+// instructions shown by default
+constexpr size_t DefaultCount = 32;
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: TraceDump trace [count]" << std::endl;
+		return 1;
+	}
+	const size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DefaultCount;
+
+	std::vector<TraceEntry> entries;
+	if (!ReadTrace(argv[1], count, entries))
+	{
+		std::cerr << argv[1] << " is not an Intcode trace" << std::endl;
+		return 1;
+	}
+
+	WriteTrace(std::cout, entries);
+
+	return 0;
+}
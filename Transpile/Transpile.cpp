@@ -0,0 +1,360 @@
+// Intcode to C++ transpiler
+//
+// Reads an Intcode program from the standard input and writes a C++
+// translation unit to the standard output that runs it as native code.
+// Every instruction static analysis finds by following the control flow
+// from address 0 (and from immediate operands that decode as plausible code,
+// which catches return addresses pushed for computed jumps; see
+// Intcode/Analysis.h) becomes a labelled block of C++.  Memory is the
+// computer's flat program image, grown to a fixed size.  Computed jumps go
+// through a switch over the labels, and the computer's interpreter runs
+// anything the translation does not cover; see Intcode/Transpiled.h for the
+// interface of the generated function.
+//
+// usage: Transpile [name [memory words]] < input.txt > name.cpp
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+#include "../Intcode/Intcode.h"
+#include "../Intcode/Analysis.h"
+
+// default size of the flat memory in words
+constexpr size_t DefaultMemory = 1 << 16;
+
+// marks for the generated code, from the flags of the analysis
+enum Mark : uint8_t
+{
+	Code = 1,	// part of an instruction reachable from the entry point
+	Start = 2,	// start of a translated instruction
+	Guess = 4,	// start of an instruction that is only plausibly code
+};
+
+struct Program
+{
+	std::vector<int64_t> image;
+	std::vector<uint8_t> marks;
+	std::vector<int64_t> labels;
+};
+
+// find the instructions to translate: every instruction the analysis finds,
+// counting only those reachable from address 0 as code to watch for changes
+void Analyse(Program& program)
+{
+	const Analysis analysis(program.image);
+	program.marks.assign(program.image.size(), 0);
+	for (size_t address = 0; address < program.image.size(); ++address)
+	{
+		const uint8_t flags = analysis.At(int64_t(address));
+		if (!(flags & Analysis::Start))
+			continue;
+		program.labels.push_back(int64_t(address));
+		if (flags & Analysis::Guessed)
+		{
+			program.marks[address] |= Start | Guess;
+			continue;
+		}
+		program.marks[address] |= Start;
+		const int length = InstructionLength(Decode(program.image[address]).opcode);
+		for (int w = 0; w < length; ++w)
+			program.marks[address + w] |= Code;
+	}
+}
+
+// C++ expression for a 64-bit constant
+std::string Literal(int64_t value)
+{
+	if (value == INT64_MIN)
+		return "INT64_MIN";
+	return "int64_t(" + std::to_string(value) + (value > INT32_MAX || value < INT32_MIN ? "LL" : "") + ")";
+}
+
+// assembly-style text for a parameter
+std::string Parameter(Mode mode, int64_t value)
+{
+	switch (mode)
+	{
+	case Mode::Position:
+		return "[" + std::to_string(value) + "]";
+	case Mode::Relative:
+		return "[base" + std::string(value < 0 ? "" : "+") + std::to_string(value) + "]";
+	default:
+		return std::to_string(value);
+	}
+}
+
+class Writer
+{
+public:
+	Writer(const Program& program, size_t words, std::ostream& out)
+		: program(program), words(words), out(out)
+	{
+	}
+
+	void Write(const std::string& name);
+
+private:
+	const Program& program;
+	size_t words;
+	std::ostream& out;
+
+	// operand expressions for the instruction being written
+	std::string reads[3];
+	std::string writes[3];
+	std::vector<std::string> checks;
+
+	bool Operands(int64_t address, const Instruction<int64_t>& i);
+	void Store(int p, const std::string& value, int64_t next);
+	void Instruction(size_t index);
+	void Array(const char* type, const char* name, size_t count, std::string(*element)(const Program&, size_t));
+};
+
+// set up the operand expressions, returning false if an address is known
+// to be out of range of the flat memory
+bool Writer::Operands(int64_t address, const ::Instruction<int64_t>& i)
+{
+	const int length = InstructionLength(i.opcode);
+	const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+	checks.clear();
+	for (int p = 1; p < length; ++p)
+	{
+		const int64_t value = program.image[address + p];
+		switch (modes[p - 1])
+		{
+		case Mode::Position:
+			if (value < 0 || uint64_t(value) >= words)
+				return false;
+			reads[p - 1] = "m[" + std::to_string(value) + "]";
+			writes[p - 1] = std::to_string(value);
+			break;
+		case Mode::Immediate:
+			// immediate mode outputs behave as position mode
+			reads[p - 1] = Literal(value);
+			if (value < 0 || uint64_t(value) >= words)
+				writes[p - 1].clear();
+			else
+				writes[p - 1] = std::to_string(value);
+			break;
+		case Mode::Relative:
+			{
+				const std::string a = "a" + std::to_string(p);
+				checks.push_back(a + " = base + " + std::to_string(value) + ";");
+				checks.push_back("if (uint64_t(" + a + ") >= Words) { pc = " + std::to_string(address) + "; goto interpret; }");
+				reads[p - 1] = "m[" + a + "]";
+				writes[p - 1] = a;
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+// store a value through parameter p, leaving translated code if it changes
+// an instruction
+void Writer::Store(int p, const std::string& value, int64_t next)
+{
+	const std::string& target = writes[p - 1];
+	out << "\tm[" << target << "] = " << value << ";\n";
+	const bool constant = target[0] != 'a';
+	if (constant)
+	{
+		const size_t word = std::stoull(target);
+		if (word < program.image.size() && (program.marks[word] & Code))
+			out << "\tif (m[" << target << "] != image[" << target << "]) { pc = " << next << "; goto modified; }\n";
+	}
+	else
+	{
+		out << "\tif (uint64_t(" << target << ") < ImageSize && (marks[" << target << "] & 1) && m[" << target << "] != image[" << target << "]) { pc = " << next << "; goto modified; }\n";
+	}
+}
+
+void Writer::Instruction(size_t index)
+{
+	const int64_t address = program.labels[index];
+	const ::Instruction<int64_t> i = Decode(program.image[address]);
+	const int length = InstructionLength(i.opcode);
+	const int64_t next = address + length;
+
+	const Mode modes[3] = { i.mode1, i.mode2, i.mode3 };
+	out << "L" << address << ":\t// " << OpcodeName(i.opcode);
+	for (int p = 1; p < length; ++p)
+		out << (p == 1 ? " " : ", ") << Parameter(modes[p - 1], program.image[address + p]);
+	out << "\n";
+
+	// guessed code may be data that has changed since
+	if (program.marks[address] & Guess)
+	{
+		out << "\tif (";
+		for (int w = 0; w < length; ++w)
+			out << (w ? " || " : "") << "m[" << address + w << "] != image[" << address + w << "]";
+		out << ") { pc = " << address << "; goto interpret; }\n";
+	}
+
+	const bool writes3 = i.opcode == Opcode::Add || i.opcode == Opcode::Multiply || i.opcode == Opcode::LessThan || i.opcode == Opcode::Equals;
+	if (!Operands(address, i) || (writes3 && writes[2].empty()) || (i.opcode == Opcode::Input && writes[0].empty()))
+	{
+		out << "\tpc = " << address << "; goto interpret;\n";
+		return;
+	}
+	for (const std::string& check : checks)
+		out << "\t" << check << "\n";
+
+	switch (i.opcode)
+	{
+	case Opcode::Add:
+		Store(3, reads[0] + " + " + reads[1], next);
+		break;
+	case Opcode::Multiply:
+		Store(3, reads[0] + " * " + reads[1], next);
+		break;
+	case Opcode::LessThan:
+		Store(3, reads[0] + " < " + reads[1], next);
+		break;
+	case Opcode::Equals:
+		Store(3, reads[0] + " == " + reads[1], next);
+		break;
+	case Opcode::Input:
+		out << "\tif (!io.input(io.context, value)) { pc = " << address << "; state = State::Wait; goto done; }\n";
+		Store(1, "value", next);
+		break;
+	case Opcode::Output:
+		out << "\tif (!io.output(io.context, " << reads[0] << ")) { pc = " << next << "; state = State::Output; goto done; }\n";
+		break;
+	case Opcode::JumpIfTrue:
+	case Opcode::JumpIfFalse:
+		{
+			const std::string condition = i.opcode == Opcode::JumpIfTrue ? reads[0] + " != 0" : reads[0] + " == 0";
+			const int64_t target = program.image[address + 2];
+			if (i.mode2 == Mode::Immediate && target >= 0 && size_t(target) < program.image.size() && (program.marks[target] & Start))
+				out << "\tif (" << condition << ") goto L" << target << ";\n";
+			else
+				out << "\tif (" << condition << ") { pc = " << reads[1] << "; goto dispatch; }\n";
+		}
+		break;
+	case Opcode::RelativeBaseOffset:
+		out << "\tbase += " << reads[0] << ";\n";
+		break;
+	case Opcode::Halt:
+		out << "\tpc = " << address << "; state = State::Halt; goto done;\n";
+		return;
+	default:
+		break;
+	}
+
+	// continue with the next instruction, through the dispatcher if it was
+	// not translated
+	if (size_t(next) >= program.image.size() || !(program.marks[next] & Start))
+		out << "\tpc = " << next << "; goto dispatch;\n";
+	else if (index + 1 == program.labels.size() || program.labels[index + 1] != next)
+		out << "\tgoto L" << next << ";\n";
+}
+
+void Writer::Array(const char* type, const char* name, size_t count, std::string(*element)(const Program&, size_t))
+{
+	out << "\tstatic const " << type << " " << name << "[ImageSize] =\n\t{";
+	for (size_t i = 0; i < count; ++i)
+		out << (i % 16 == 0 ? "\n\t\t" : " ") << element(program, i) << ",";
+	out << "\n\t};\n";
+}
+
+void Writer::Write(const std::string& name)
+{
+	out << "// Intcode program transpiled to C++ by Transpile\n";
+	out << "// (" << program.labels.size() << " of " << program.image.size() << " words translated as instructions)\n";
+	out << "\n";
+	out << "#include \"../Intcode/Transpiled.h\"\n";
+	out << "\n";
+	out << "State " << name << "(Computer<int64_t>& computer, const IntcodeIO& io)\n";
+	out << "{\n";
+	out << "\tconstexpr size_t ImageSize = " << program.image.size() << ";\n";
+	out << "\tconstexpr size_t Words = " << words << ";\n";
+	out << "\n";
+	out << "\t// the program as translated\n";
+	Array("int64_t", "image", program.image.size(), [](const Program& program, size_t i) { return Literal(program.image[i]); });
+	out << "\n";
+	out << "\t// words of instructions reachable from address 0 (1) and starts of\n";
+	out << "\t// translated instructions (2), some of them guessed (4)\n";
+	Array("uint8_t", "marks", program.image.size(), [](const Program& program, size_t i) { return std::to_string(program.marks[i]); });
+	out << "\n";
+	out << "\tcomputer.memory.Grow(Words);\n";
+	out << "\tint64_t* const m = computer.memory.data();\n";
+	out << "\tint64_t pc = computer.pc;\n";
+	out << "\tint64_t base = computer.relativebase;\n";
+	out << "\tint64_t value, a1, a2, a3;\n";
+	out << "\tState state;\n";
+	out << "\n";
+	out << "\t// translated code is only good while the instructions are unchanged\n";
+	out << "\tbool intact = true;\n";
+	out << "\tfor (size_t a = 0; a < ImageSize && intact; ++a)\n";
+	out << "\t\tintact = !(marks[a] & 1) || m[a] == image[a];\n";
+	out << "\tif (!intact)\n";
+	out << "\t\tgoto modified;\n";
+	out << "\n";
+	out << "dispatch:\n";
+	out << "\tswitch (pc)\n";
+	out << "\t{\n";
+	for (const int64_t label : program.labels)
+		out << "\tcase " << label << ": goto L" << label << ";\n";
+	out << "\tdefault: goto interpret;\n";
+	out << "\t}\n";
+	out << "\n";
+
+	for (size_t index = 0; index < program.labels.size(); ++index)
+		Instruction(index);
+
+	out << "\n";
+	out << "modified:\n";
+	out << "\tintact = false;\n";
+	out << "\n";
+	out << "interpret:\n";
+	out << "\t// run the interpreter until it reaches translated code\n";
+	out << "\tcomputer.pc = pc;\n";
+	out << "\tcomputer.relativebase = base;\n";
+	out << "\tcomputer.Invalidate();\n";
+	out << "\tdo\n";
+	out << "\t{\n";
+	out << "\t\tstate = StepIO(computer, io);\n";
+	out << "\t\tif (state != State::Run)\n";
+	out << "\t\t\treturn state;\n";
+	out << "\t}\n";
+	out << "\twhile (!intact || uint64_t(computer.pc) >= ImageSize || !(marks[computer.pc] & 2));\n";
+	out << "\tpc = computer.pc;\n";
+	out << "\tbase = computer.relativebase;\n";
+	out << "\tgoto dispatch;\n";
+	out << "\n";
+	out << "done:\n";
+	out << "\tcomputer.pc = pc;\n";
+	out << "\tcomputer.relativebase = base;\n";
+	out << "\treturn state;\n";
+	out << "}\n";
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string name = argc > 1 ? argv[1] : "Program";
+	const size_t words = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DefaultMemory;
+
+	Program program;
+	if (!ReadInput(program.image, std::cin))
+	{
+		std::cerr << "the standard input holds something that is not an Intcode word" << std::endl;
+		return 1;
+	}
+	if (program.image.empty())
+	{
+		std::cerr << "no program on the standard input" << std::endl;
+		return 1;
+	}
+
+	Analyse(program);
+
+	Writer writer(program, std::max(words, program.image.size()), std::cout);
+	writer.Write(name);
+
+	return 0;
+}